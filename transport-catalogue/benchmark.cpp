@@ -0,0 +1,634 @@
+#include "transport_catalogue.h"
+#include "transport_router.h"
+#include "geo.h"
+#include "min_plus.h"
+#include "router.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <deque>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <numeric>
+#include <optional>
+#include <queue>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+
+// Timings of the optimized paths against the paths they replaced, on generated networks.
+// Every section also checks that both paths give the same results, the program fails otherwise.
+// Usage: benchmark [section...], all the sections by default.
+
+using namespace std::literals;
+using namespace transport_catalogue;
+
+namespace {
+
+    struct Network {
+        struct Road {
+            size_t from;
+            size_t to;
+            double distance;
+        };
+
+        struct Route {
+            std::string name;
+            std::vector<size_t> stops;
+            bool is_ring_route = false;
+        };
+
+        std::vector<std::string> stop_names;
+        std::vector<geo::Coordinates> coordinates;
+        std::vector<Road> roads;
+        std::vector<Route> buses;
+    };
+
+    // stops scattered over a city-sized square, buses through random stops;
+    // a road distance is given for two segments of three, the rest is left to the straight line
+    Network GenerateNetwork(size_t stop_count, size_t bus_count, size_t stops_per_bus, unsigned seed) {
+        std::mt19937 generator(seed);
+        std::uniform_real_distribution<double> lat(55.5, 55.9);
+        std::uniform_real_distribution<double> lng(37.3, 37.9);
+        std::uniform_int_distribution<size_t> stop(0, stop_count - 1);
+        std::uniform_real_distribution<double> detour(1.1, 1.8);
+
+        Network network;
+        for (size_t i = 0; i < stop_count; ++i) {
+            network.stop_names.push_back("Stop "s + std::to_string(i) + " of a long generated street"s);
+            network.coordinates.push_back({ lat(generator), lng(generator) });
+        }
+
+        for (size_t i = 0; i < bus_count; ++i) {
+            Network::Route& route = network.buses.emplace_back();
+            route.name = "Bus "s + std::to_string(i);
+            route.is_ring_route = i % 2 == 0;
+
+            for (size_t j = 0; j < stops_per_bus; ++j) {
+                route.stops.push_back(stop(generator));
+                if (j > 0 && generator() % 3 != 0) {
+                    const size_t from = route.stops[j - 1];
+                    const size_t to = route.stops[j];
+                    network.roads.push_back({ from, to, std::round(geo::ComputeDistance(network.coordinates[from], network.coordinates[to]) * detour(generator)) });
+                }
+            }
+            if (route.is_ring_route) {
+                route.stops.push_back(route.stops.front());
+            }
+        }
+
+        return network;
+    }
+
+    // the same order as make_base: stops, distances, buses, indexes
+    void FillCatalogue(Catalogue& catalogue, const Network& network) {
+        for (size_t i = 0; i < network.stop_names.size(); ++i) {
+            catalogue.AddStop(network.stop_names[i], network.coordinates[i]);
+        }
+        for (const Network::Road& road : network.roads) {
+            catalogue.AddDistance(catalogue.FindStop(network.stop_names[road.from]), catalogue.FindStop(network.stop_names[road.to]), road.distance);
+        }
+        for (const Network::Route& route : network.buses) {
+            std::vector<std::string_view> stops;
+            for (size_t stop : route.stops) {
+                stops.push_back(network.stop_names[stop]);
+            }
+            catalogue.AddBus(route.name, stops, route.is_ring_route);
+        }
+        catalogue.BuildIndexes();
+    }
+
+    // the best of a few runs: it is the least disturbed by the rest of the machine
+    template <typename Function>
+    double MeasureMilliseconds(Function function, int run_count = 3) {
+        double best = std::numeric_limits<double>::infinity();
+        for (int run = 0; run < run_count; ++run) {
+            const auto start = std::chrono::steady_clock::now();
+            function();
+            best = std::min(best, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+        }
+        return best;
+    }
+
+    void PrintComparison(std::string_view name, double old_milliseconds, double new_milliseconds) {
+        std::cout << "  " << name << ": old " << old_milliseconds << " ms, new " << new_milliseconds << " ms, "
+            << old_milliseconds / new_milliseconds << "x" << std::endl;
+    }
+
+    void Check(bool condition, std::string_view what) {
+        if (!condition) {
+            throw std::runtime_error("Check failed: "s + std::string(what));
+        }
+    }
+
+    bool IsClose(double lhs, double rhs) {
+        return std::abs(lhs - rhs) <= 1e-9 * std::max({ 1., std::abs(lhs), std::abs(rhs) });
+    }
+
+
+
+    // - ride times of the dense graph model: a sum over the segments of every edge against the per-bus prefix sums
+    void BenchmarkRideTimes() {
+        const Network network = GenerateNetwork(2000, 300, 40, 7);
+        Catalogue catalogue(6., 40.);
+        FillCatalogue(catalogue, network);
+
+        // * the old path walked every segment between the ends of each edge; the segment lookups are the current ones,
+        // so only the summation differs
+        double old_sum = 0.;
+        const double old_milliseconds = MeasureMilliseconds([&catalogue, &old_sum]() {
+            old_sum = 0.;
+            for (const Bus& bus : catalogue.GetBuses()) {
+                const std::vector<Stop*> stops = bus.GetStops();
+                for (size_t begin = 0; begin < stops.size(); ++begin) {
+                    const size_t end = begin == 0 && bus.is_ring_route ? stops.size() - 1 : stops.size();
+                    for (size_t destination = begin + 1; destination < end; ++destination) {
+                        for (size_t i = begin; i < destination; ++i) {
+                            old_sum += catalogue.GetBusRideTime(stops[i], stops[i + 1]);
+                        }
+                        if (!bus.is_ring_route) {
+                            for (size_t i = destination; i > begin; --i) {
+                                old_sum += catalogue.GetBusRideTime(stops[i], stops[i - 1]);
+                            }
+                        }
+                    }
+                }
+            }
+        });
+
+        // * the new time is the whole construction of the graph, edges and engine included
+        RoutingSettings settings;
+        settings.router_type = RouterType::DIJKSTRA;
+        std::optional<TransportRouter> router;
+        const double new_milliseconds = MeasureMilliseconds([&catalogue, &settings, &router]() {
+            router.emplace(catalogue, settings);
+        });
+
+        double new_sum = 0.;
+        for (graph::EdgeId edge_id = 0; edge_id < router->GetGraph().GetEdgeCount(); ++edge_id) {
+            if (router->GetEdgeInfos()[edge_id].type == TransportRouter::PassengerActivityType::BUS) {
+                new_sum += router->GetGraph().GetEdge(edge_id).weight;
+            }
+        }
+
+        Check(IsClose(old_sum, new_sum), "the ride times of the dense graph match the sums over the segments");
+        PrintComparison("dense graph of 300 buses of 40 stops", old_milliseconds, new_milliseconds);
+    }
+
+
+
+    // one Dijkstra search per source over the edges given by incident_edges and get_edge,
+    // returns the sum of the settled weights and counts the relaxed edges
+    template <typename IncidentEdges, typename GetEdge>
+    double RunSearches(size_t vertex_count, const std::vector<graph::VertexId>& sources, IncidentEdges incident_edges, GetEdge get_edge, size_t& relaxation_count) {
+        using QueueEntry = std::pair<double, graph::VertexId>;
+
+        double result = 0.;
+        relaxation_count = 0;
+        std::vector<double> weights(vertex_count);
+        std::priority_queue<QueueEntry, std::vector<QueueEntry>, std::greater<QueueEntry>> queue;
+
+        for (const graph::VertexId source : sources) {
+            std::fill(weights.begin(), weights.end(), std::numeric_limits<double>::infinity());
+            weights[source] = 0.;
+            queue.push({ 0., source });
+
+            while (!queue.empty()) {
+                const auto [weight, vertex] = queue.top();
+                queue.pop();
+                if (weight > weights[vertex]) {
+                    continue;
+                }
+                result += weight;
+
+                for (const graph::EdgeId edge_id : incident_edges(vertex)) {
+                    const graph::Edge<double>& edge = get_edge(edge_id);
+                    ++relaxation_count;
+                    if (weight + edge.weight < weights[edge.to]) {
+                        weights[edge.to] = weight + edge.weight;
+                        queue.push({ weights[edge.to], edge.to });
+                    }
+                }
+            }
+        }
+
+        return result;
+    }
+
+    // - edge relaxation: incidence lists of the growing graph against the frozen compressed sparse row form
+    void BenchmarkRelaxation() {
+        const Network network = GenerateNetwork(2000, 300, 40, 10);
+        Catalogue catalogue(6., 40.);
+        FillCatalogue(catalogue, network);
+
+        RoutingSettings settings;
+        settings.router_type = RouterType::DIJKSTRA;
+        const TransportRouter router(catalogue, settings);
+        const graph::DirectedWeightedGraph<double>& graph = router.GetGraph();
+
+        // * the old graph: the edges in the order of addition (the waits, then bus by bus),
+        // a vector of edge ids per vertex, both lookups bounds-checked
+        std::vector<graph::EdgeId> addition_order(graph.GetEdgeCount());
+        std::iota(addition_order.begin(), addition_order.end(), graph::EdgeId{ 0 });
+        std::stable_sort(addition_order.begin(), addition_order.end(), [&router](graph::EdgeId lhs, graph::EdgeId rhs) {
+            const TransportRouter::EdgeInfo& lhs_info = router.GetEdgeInfos()[lhs];
+            const TransportRouter::EdgeInfo& rhs_info = router.GetEdgeInfos()[rhs];
+            return std::pair{ lhs_info.type != TransportRouter::PassengerActivityType::WAIT, lhs_info.id }
+                < std::pair{ rhs_info.type != TransportRouter::PassengerActivityType::WAIT, rhs_info.id };
+        });
+        std::vector<graph::Edge<double>> old_edges;
+        for (const graph::EdgeId edge_id : addition_order) {
+            old_edges.push_back(graph.GetEdge(edge_id));
+        }
+        std::vector<std::vector<graph::EdgeId>> old_incidence_lists(graph.GetVertexCount());
+        for (graph::EdgeId edge_id = 0; edge_id < old_edges.size(); ++edge_id) {
+            old_incidence_lists[old_edges[edge_id].from].push_back(edge_id);
+        }
+
+        std::mt19937 generator(10);
+        std::vector<graph::VertexId> sources;
+        for (size_t i = 0; i < 20; ++i) {
+            sources.push_back(generator() % graph.GetVertexCount());
+        }
+
+        double old_sum = 0.;
+        size_t old_relaxation_count = 0;
+        const double old_milliseconds = MeasureMilliseconds([&]() {
+            old_sum = RunSearches(graph.GetVertexCount(), sources,
+                [&old_incidence_lists](graph::VertexId vertex) -> const std::vector<graph::EdgeId>& { return old_incidence_lists.at(vertex); },
+                [&old_edges](graph::EdgeId edge_id) -> const graph::Edge<double>& { return old_edges.at(edge_id); },
+                old_relaxation_count);
+        });
+
+        double new_sum = 0.;
+        size_t new_relaxation_count = 0;
+        const double new_milliseconds = MeasureMilliseconds([&]() {
+            new_sum = RunSearches(graph.GetVertexCount(), sources,
+                [&graph](graph::VertexId vertex) { return graph.GetIncidentEdges(vertex); },
+                [&graph](graph::EdgeId edge_id) -> const graph::Edge<double>& { return graph.GetEdge(edge_id); },
+                new_relaxation_count);
+        });
+
+        Check(IsClose(old_sum, new_sum) && old_relaxation_count == new_relaxation_count, "both graph forms give the same searches");
+        PrintComparison("20 searches over " + std::to_string(graph.GetEdgeCount()) + " edges", old_milliseconds, new_milliseconds);
+        std::cout << "  relaxations per second: old " << old_relaxation_count / old_milliseconds * 1e3
+            << ", new " << new_relaxation_count / new_milliseconds * 1e3 << std::endl;
+    }
+
+
+
+    // - min-plus row updates of the Floyd-Warshall matrix: the kernel picked for the CPU against the scalar one
+    void BenchmarkMinPlus() {
+        using graph::Router;
+
+        const std::string_view kernel_name = [] {
+            const graph::min_plus::RelaxRowKernel kernel = graph::min_plus::SelectRelaxRowKernel();
+#ifdef GRAPH_MIN_PLUS_X86
+            if (kernel == graph::min_plus::RelaxRowAvx512) {
+                return "avx512"sv;
+            }
+            if (kernel == graph::min_plus::RelaxRowAvx2) {
+                return "avx2"sv;
+            }
+#endif
+            return kernel == graph::min_plus::RelaxRowScalar ? "scalar"sv : "unknown"sv;
+        }();
+        std::cout << "  kernel: " << kernel_name << std::endl;
+
+        std::mt19937 generator(12);
+        std::uniform_real_distribution<double> weight(1., 100.);
+
+        for (const size_t size : { 256, 1024, 2048 }) {
+            // * a third of the pairs without a route, as in a sparse network before the first rounds
+            std::vector<double> weights(size * size);
+            std::vector<uint32_t> prev_edges(size * size);
+            for (size_t i = 0; i < weights.size(); ++i) {
+                const bool has_route = generator() % 3 != 0;
+                weights[i] = has_route ? weight(generator) : Router<double>::NO_ROUTE;
+                prev_edges[i] = has_route ? static_cast<uint32_t>(generator() % 1000000) : Router<double>::NO_EDGE;
+            }
+            // * up to 64M cell updates for every size, every vertex is a pivot once at most
+            const size_t pivot_count = std::min(size, std::max<size_t>(1, (64u << 20) / (size * size)));
+
+            auto run = [&](graph::min_plus::RelaxRowKernel kernel, std::vector<double>& result_weights, std::vector<uint32_t>& result_prev_edges) {
+                double best = std::numeric_limits<double>::infinity();
+                for (int attempt = 0; attempt < 3; ++attempt) {
+                    result_weights = weights;
+                    result_prev_edges = prev_edges;
+                    best = std::min(best, MeasureMilliseconds([&]() {
+                        for (size_t through = 0; through < pivot_count; ++through) {
+                            for (size_t from = 0; from < size; ++from) {
+                                const double weight_from = result_weights[from * size + through];
+                                if (weight_from == Router<double>::NO_ROUTE) {
+                                    continue;
+                                }
+                                kernel({
+                                    result_weights.data() + from * size,
+                                    result_prev_edges.data() + from * size,
+                                    result_weights.data() + through * size,
+                                    result_prev_edges.data() + through * size,
+                                    weight_from,
+                                    result_prev_edges[from * size + through],
+                                    Router<double>::NO_EDGE }, 0, size);
+                            }
+                        }
+                    }, 1));
+                }
+                return best;
+            };
+
+            std::vector<double> old_weights, new_weights;
+            std::vector<uint32_t> old_prev_edges, new_prev_edges;
+            const double old_milliseconds = run(graph::min_plus::RelaxRowScalar, old_weights, old_prev_edges);
+            const double new_milliseconds = run(graph::min_plus::SelectRelaxRowKernel(), new_weights, new_prev_edges);
+
+            Check(old_weights == new_weights && old_prev_edges == new_prev_edges, "the kernels give the same matrix");
+            PrintComparison(std::to_string(size) + "x" + std::to_string(size) + ", " + std::to_string(pivot_count) + " pivots", old_milliseconds, new_milliseconds);
+        }
+    }
+
+
+
+    // the hasher of the old distance map: both stop names are hashed on every lookup
+    struct StopNamesPairHasher {
+        size_t operator()(std::pair<const Stop*, const Stop*> stops) const {
+            return std::hash<std::string_view>{}(stops.first->name) + std::hash<std::string_view>{}(stops.second->name) * 42;
+        }
+    };
+
+    // - road distance lookups: the flat table keyed by stop ids against the map keyed by stop pointers with hashed names
+    void BenchmarkDistanceLookups() {
+        const size_t stop_count = 20000;
+        const size_t pair_count = 100000;
+        const size_t lookup_count = 2000000;
+
+        const Network network = GenerateNetwork(stop_count, 0, 0, 17);
+        Catalogue catalogue(6., 40.);
+        FillCatalogue(catalogue, network);
+        const std::deque<Stop>& stops = catalogue.GetStops();
+
+        std::mt19937 generator(17);
+        std::uniform_real_distribution<double> distance(100., 5000.);
+        while (catalogue.GetDistances().Size() < pair_count) {
+            const Stop& from = stops[generator() % stop_count];
+            const Stop& to = stops[generator() % stop_count];
+            catalogue.AddDistance(catalogue.FindStop(from.name), catalogue.FindStop(to.name), std::round(distance(generator)));
+        }
+
+        std::unordered_map<std::pair<const Stop*, const Stop*>, double, StopNamesPairHasher> old_distances;
+        std::vector<std::pair<const Stop*, const Stop*>> keys;
+        for (const auto& [stop_ids, value] : catalogue.GetDistances()) {
+            const std::pair<const Stop*, const Stop*> key{ &stops[stop_ids.first], &stops[stop_ids.second] };
+            old_distances.emplace(key, value);
+            keys.push_back(key);
+        }
+
+        std::vector<std::pair<const Stop*, const Stop*>> lookups;
+        lookups.reserve(lookup_count);
+        for (size_t i = 0; i < lookup_count; ++i) {
+            lookups.push_back(keys[generator() % keys.size()]);
+        }
+
+        double old_sum = 0.;
+        const double old_milliseconds = MeasureMilliseconds([&old_distances, &lookups, &old_sum]() {
+            old_sum = 0.;
+            for (const auto& key : lookups) {
+                old_sum += old_distances.at(key);
+            }
+        });
+
+        const Catalogue::Distances& new_distances = catalogue.GetDistances();
+        double new_sum = 0.;
+        const double new_milliseconds = MeasureMilliseconds([&new_distances, &lookups, &new_sum]() {
+            new_sum = 0.;
+            for (const auto& [from, to] : lookups) {
+                new_sum += *new_distances.Find(from->id, to->id);
+            }
+        });
+
+        Check(old_sum == new_sum, "both tables give the same distances");
+        PrintComparison("2M lookups in 100k pairs", old_milliseconds, new_milliseconds);
+    }
+
+
+
+    // - nearest stops: the grid of the catalogue against a scan of every stop
+    void BenchmarkNearestStops() {
+        const size_t stop_count = 50000;
+        const size_t point_count = 1000;
+        const size_t count = 10;
+        const double radius = 500.;
+
+        const Network network = GenerateNetwork(stop_count, 0, 0, 21);
+        Catalogue catalogue(6., 40.);
+        FillCatalogue(catalogue, network);
+
+        std::mt19937 generator(21);
+        std::uniform_real_distribution<double> lat(55.5, 55.9);
+        std::uniform_real_distribution<double> lng(37.3, 37.9);
+        std::vector<geo::Coordinates> points;
+        for (size_t i = 0; i < point_count; ++i) {
+            points.push_back({ lat(generator), lng(generator) });
+        }
+
+        // * distances of the found stops per query, sorted
+        using Results = std::vector<std::vector<double>>;
+
+        auto scan = [&catalogue, &points](std::optional<size_t> count, std::optional<double> radius) {
+            Results results;
+            for (const geo::Coordinates point : points) {
+                std::vector<double> distances;
+                for (const Stop& stop : catalogue.GetStops()) {
+                    const double distance = geo::ComputeDistance(point, stop.coordinates);
+                    if (!radius || distance <= *radius) {
+                        distances.push_back(distance);
+                    }
+                }
+                if (count && distances.size() > *count) {
+                    std::nth_element(distances.begin(), distances.begin() + *count, distances.end());
+                    distances.resize(*count);
+                }
+                std::sort(distances.begin(), distances.end());
+                results.push_back(std::move(distances));
+            }
+            return results;
+        };
+
+        auto search = [&catalogue, &points](std::optional<size_t> count, std::optional<double> radius) {
+            Results results;
+            for (const geo::Coordinates point : points) {
+                std::vector<double>& distances = results.emplace_back();
+                for (const auto& [stop, distance] : catalogue.FindNearestStops(point, count, radius)) {
+                    distances.push_back(distance);
+                }
+            }
+            return results;
+        };
+
+        // * the scan measures with the arc cosine, the grid with the haversine: they differ by centimetres,
+        // so a stop right at the radius may be in one result only
+        auto is_same = [](const Results& lhs, const Results& rhs, std::optional<double> radius) {
+            for (size_t i = 0; i < lhs.size(); ++i) {
+                const std::vector<double>& shorter = lhs[i].size() <= rhs[i].size() ? lhs[i] : rhs[i];
+                const std::vector<double>& longer = lhs[i].size() <= rhs[i].size() ? rhs[i] : lhs[i];
+                for (size_t j = 0; j < longer.size(); ++j) {
+                    if (j < shorter.size() ? std::abs(shorter[j] - longer[j]) > 0.5 : !radius || std::abs(longer[j] - *radius) > 0.5) {
+                        return false;
+                    }
+                }
+            }
+            return true;
+        };
+
+        for (const auto& [name, query_limit, query_radius] : {
+            std::tuple{ "10 nearest"s, std::optional<size_t>{ count }, std::optional<double>{} },
+            std::tuple{ "within 500 m"s, std::optional<size_t>{}, std::optional<double>{ radius } } }) {
+            Results old_results, new_results;
+            // * a single run of the scan: it takes seconds
+            const double old_milliseconds = MeasureMilliseconds([&]() { old_results = scan(query_limit, query_radius); }, 1);
+            const double new_milliseconds = MeasureMilliseconds([&]() { new_results = search(query_limit, query_radius); });
+
+            Check(is_same(old_results, new_results, query_radius), "the grid finds the stops of the scan");
+            PrintComparison("1000 queries, " + name + " of 50000 stops", old_milliseconds, new_milliseconds);
+        }
+    }
+
+
+
+    // - update_base: the changes applied to a built catalogue with the router repaired, against a fresh build of the changed data
+    void BenchmarkUpdate() {
+        Network network = GenerateNetwork(600, 80, 12, 14);
+        RoutingSettings settings;
+
+        Catalogue updated_catalogue(6., 40.);
+        FillCatalogue(updated_catalogue, network);
+        std::optional<TransportRouter> router;
+        router.emplace(updated_catalogue, settings);
+
+        // * a segment of a two-way bus without a road distance either way:
+        // its straight line must give way to the new distance in both directions
+        const std::vector<size_t>& first_stops = network.buses[3].stops;
+        Check(!network.buses[3].is_ring_route, "the generated bus 3 goes both ways");
+        size_t segment = 1;
+        auto has_road = [&network](size_t from, size_t to) {
+            return std::any_of(network.roads.begin(), network.roads.end(), [from, to](const Network::Road& road) {
+                return (road.from == from && road.to == to) || (road.from == to && road.to == from);
+            });
+        };
+        while (segment < first_stops.size() && has_road(first_stops[segment - 1], first_stops[segment])) {
+            ++segment;
+        }
+        Check(segment < first_stops.size(), "the generated network has a segment without a road distance");
+        const size_t road_from = first_stops[segment - 1];
+        const size_t road_to = first_stops[segment];
+
+        const std::string added_stop = "Added stop"s;
+        const geo::Coordinates added_coordinates{ network.coordinates[0].lat + 0.001, network.coordinates[0].lng };
+        std::vector<size_t> reversed_stops = network.buses[2].stops;
+        std::reverse(reversed_stops.begin(), reversed_stops.end());
+
+        // * the order of update_base: stops, distances, then buses
+        const double update_milliseconds = MeasureMilliseconds([&]() {
+            const std::vector<TransportRouter::EdgeKey> previous_edge_keys = router->GetEdgeKeys();
+
+            updated_catalogue.AddStop(added_stop, added_coordinates);
+            updated_catalogue.AddDistance(updated_catalogue.FindStop(added_stop), updated_catalogue.FindStop(network.stop_names[1]), 900.);
+            updated_catalogue.AddDistance(updated_catalogue.FindStop(network.stop_names[road_from]), updated_catalogue.FindStop(network.stop_names[road_to]), 3000.);
+
+            updated_catalogue.RemoveBus(network.buses[1].name);
+            std::vector<std::string_view> stops;
+            for (size_t stop : reversed_stops) {
+                stops.push_back(network.stop_names[stop]);
+            }
+            updated_catalogue.UpdateBus(network.buses[2].name, stops, network.buses[2].is_ring_route);
+            updated_catalogue.UpdateBus("Added bus"s, { network.stop_names[0], added_stop, network.stop_names[1] }, false);
+            updated_catalogue.BuildIndexes();
+
+            TransportRouter updated_router(updated_catalogue, std::move(*router), previous_edge_keys);
+            router.reset();
+            router.emplace(std::move(updated_router));
+        }, 1);
+        Check(router->IsEngineRepaired(), "the Floyd-Warshall matrix is repaired");
+
+        network.stop_names.push_back(added_stop);
+        network.coordinates.push_back(added_coordinates);
+        network.roads.push_back({ network.stop_names.size() - 1, 1, 900. });
+        network.roads.push_back({ road_from, road_to, 3000. });
+        network.buses[2].stops = reversed_stops;
+        network.buses.push_back({ "Added bus"s, { 0, network.stop_names.size() - 1, 1 }, false });
+        network.buses.erase(network.buses.begin() + 1);
+
+        Catalogue fresh_catalogue(6., 40.);
+        std::optional<TransportRouter> fresh_router;
+        const double fresh_milliseconds = MeasureMilliseconds([&]() {
+            FillCatalogue(fresh_catalogue, network);
+            fresh_router.emplace(fresh_catalogue, settings);
+        }, 1);
+
+        for (const Network::Route& bus : network.buses) {
+            const std::optional<BusInfo> updated_info = updated_catalogue.GetBusInfo(bus.name);
+            const std::optional<BusInfo> fresh_info = fresh_catalogue.GetBusInfo(bus.name);
+            Check(updated_info && fresh_info
+                && updated_info->stops_count == fresh_info->stops_count
+                && updated_info->unique_stops_count == fresh_info->unique_stops_count
+                && IsClose(updated_info->route_length, fresh_info->route_length)
+                && IsClose(updated_info->curvature, fresh_info->curvature), "the updated buses match the fresh build");
+        }
+
+        // * equal times are enough: a tie between routes may be broken differently
+        std::mt19937 generator(14);
+        for (size_t i = 0; i < 2000; ++i) {
+            const std::string& from = network.stop_names[generator() % network.stop_names.size()];
+            const std::string& to = network.stop_names[generator() % network.stop_names.size()];
+            const json::Dict updated_route = router->BuildRoute(from, to).AsDict();
+            const json::Dict fresh_route = fresh_router->BuildRoute(from, to).AsDict();
+            Check(updated_route.count("total_time"s) == fresh_route.count("total_time"s)
+                && (!updated_route.count("total_time"s) || IsClose(updated_route.at("total_time"s).AsDouble(), fresh_route.at("total_time"s).AsDouble())),
+                "the updated routes match the fresh build");
+        }
+
+        PrintComparison("5 changes in 80 buses, update against a fresh build", fresh_milliseconds, update_milliseconds);
+    }
+
+
+
+    struct Section {
+        std::string_view name;
+        void (*run)();
+    };
+
+    const Section SECTIONS[] = {
+        { "ride_times"sv, BenchmarkRideTimes },
+        { "relaxation"sv, BenchmarkRelaxation },
+        { "min_plus"sv, BenchmarkMinPlus },
+        { "distance_lookups"sv, BenchmarkDistanceLookups },
+        { "nearest_stops"sv, BenchmarkNearestStops },
+        { "update"sv, BenchmarkUpdate },
+    };
+
+}
+
+int main(int argc, char* argv[]) {
+    const std::vector<std::string_view> names(argv + 1, argv + argc);
+
+    try {
+        for (const Section& section : SECTIONS) {
+            if (!names.empty() && std::find(names.begin(), names.end(), section.name) == names.end()) {
+                continue;
+            }
+            std::cout << section.name << std::endl;
+            section.run();
+        }
+    }
+    catch (const std::exception& error) {
+        std::cerr << error.what() << std::endl;
+        return 1;
+    }
+}
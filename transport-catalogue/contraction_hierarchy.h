@@ -0,0 +1,600 @@
+#pragma once
+
+#include "graph.h"
+#include "router.h"
+
+#include <algorithm>
+#include <functional>
+#include <optional>
+#include <queue>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace graph {
+
+// Contraction hierarchy over a DirectedWeightedGraph. Vertices are contracted
+// one by one in order of importance; every path that goes through a contracted
+// vertex is preserved by a shortcut arc unless a witness path proves it
+// redundant. Queries run two upward searches, so only a small part of the
+// graph is visited, and shortcuts are unpacked back into the original edges.
+template <typename Weight>
+class ContractionHierarchy {
+private:
+    using Graph = DirectedWeightedGraph<Weight>;
+
+public:
+    using RouteInfo = typename Router<Weight>::RouteInfo;
+
+    // Arcs with ids below the graph edge count mirror the graph edges,
+    // all further arcs are shortcuts made of two earlier arcs.
+    struct Shortcut {
+        VertexId from;
+        VertexId to;
+        EdgeId first;
+        EdgeId second;
+    };
+
+    explicit ContractionHierarchy(const Graph& graph);
+    explicit ContractionHierarchy(const Graph& graph, std::vector<size_t>&& ranks, std::vector<Shortcut>&& shortcuts);
+
+    std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const;
+
+    const std::vector<size_t>& GetRanks() const;
+    std::vector<Shortcut> GetShortcuts() const;
+
+private:
+    static constexpr EdgeId NO_ARC = static_cast<EdgeId>(-1);
+    static constexpr size_t WITNESS_SEARCH_SETTLED_LIMIT = 64;
+
+    struct Arc {
+        VertexId from;
+        VertexId to;
+        Weight weight;
+        EdgeId first = NO_ARC;
+        EdgeId second = NO_ARC;
+    };
+
+    struct QueueEntry {
+        Weight weight;
+        VertexId vertex;
+
+        bool operator>(const QueueEntry& other) const {
+            return weight > other.weight;
+        }
+    };
+
+    struct SearchSpace {
+        std::vector<std::optional<Weight>> weights;
+        std::vector<EdgeId> parent_arcs;
+        std::vector<bool> settled;
+        std::vector<VertexId> touched_vertices;
+        std::vector<QueueEntry> queue;
+
+        explicit SearchSpace(size_t vertex_count);
+
+        void Reset();
+        void Push(VertexId vertex, Weight weight, EdgeId parent_arc);
+        QueueEntry Pop();
+    };
+
+    void InitializeArcs();
+    void Contract();
+    void BuildUpwardArcs();
+
+    void RemoveContractedArcs(VertexId vertex);
+
+    // Neighbours of a vertex that are still in the graph, with the lightest arc to each of them
+    std::vector<std::pair<VertexId, EdgeId>> GetRemainingNeighbours(VertexId vertex, bool incoming) const;
+    size_t ContractVertex(VertexId vertex, bool simulate);
+    void RunWitnessSearch(VertexId source, VertexId excluded, Weight limit, size_t target_count);
+    long long CalculatePriority(VertexId vertex);
+
+    void SettleForward(std::optional<Weight>& best_weight, VertexId& meeting_vertex) const;
+    void SettleBackward(std::optional<Weight>& best_weight, VertexId& meeting_vertex) const;
+    void UnpackArc(EdgeId arc_id, std::vector<EdgeId>& edges) const;
+
+    static constexpr Weight ZERO_WEIGHT{};
+    const Graph& graph_;
+
+    std::vector<Arc> arcs_;
+    std::vector<size_t> ranks_;
+
+    // * preprocessing state
+    std::vector<std::vector<EdgeId>> remaining_out_arcs_;
+    std::vector<std::vector<EdgeId>> remaining_in_arcs_;
+    std::vector<bool> contracted_;
+    std::vector<size_t> contracted_neighbours_;
+    std::vector<bool> witness_targets_;
+
+    // * query state
+    std::vector<std::vector<EdgeId>> upward_out_arcs_;
+    std::vector<std::vector<EdgeId>> upward_in_arcs_;
+    mutable SearchSpace forward_;
+    mutable SearchSpace backward_;
+};
+
+
+
+
+
+template <typename Weight>
+ContractionHierarchy<Weight>::SearchSpace::SearchSpace(size_t vertex_count)
+    : weights(vertex_count)
+    , parent_arcs(vertex_count, NO_ARC)
+    , settled(vertex_count, false) {
+}
+
+template <typename Weight>
+void ContractionHierarchy<Weight>::SearchSpace::Reset() {
+    for (const VertexId vertex : touched_vertices) {
+        weights[vertex].reset();
+        parent_arcs[vertex] = NO_ARC;
+        settled[vertex] = false;
+    }
+    touched_vertices.clear();
+    queue.clear();
+}
+
+template <typename Weight>
+void ContractionHierarchy<Weight>::SearchSpace::Push(VertexId vertex, Weight weight, EdgeId parent_arc) {
+    if (!weights[vertex]) {
+        touched_vertices.push_back(vertex);
+    }
+    weights[vertex] = weight;
+    parent_arcs[vertex] = parent_arc;
+    queue.push_back({ weight, vertex });
+    std::push_heap(queue.begin(), queue.end(), std::greater<QueueEntry>{});
+}
+
+template <typename Weight>
+typename ContractionHierarchy<Weight>::QueueEntry ContractionHierarchy<Weight>::SearchSpace::Pop() {
+    std::pop_heap(queue.begin(), queue.end(), std::greater<QueueEntry>{});
+    const QueueEntry result = queue.back();
+    queue.pop_back();
+    return result;
+}
+
+
+
+template <typename Weight>
+ContractionHierarchy<Weight>::ContractionHierarchy(const Graph& graph)
+    : graph_(graph)
+    , ranks_(graph.GetVertexCount(), 0)
+    , forward_(graph.GetVertexCount())
+    , backward_(graph.GetVertexCount())
+{
+    InitializeArcs();
+    Contract();
+    BuildUpwardArcs();
+}
+
+template <typename Weight>
+ContractionHierarchy<Weight>::ContractionHierarchy(const Graph& graph, std::vector<size_t>&& ranks, std::vector<Shortcut>&& shortcuts)
+    : graph_(graph)
+    , ranks_(std::move(ranks))
+    , forward_(graph.GetVertexCount())
+    , backward_(graph.GetVertexCount())
+{
+    if (ranks_.size() != graph.GetVertexCount()) {
+        throw std::invalid_argument("Contraction hierarchy does not match the graph");
+    }
+
+    InitializeArcs();
+
+    for (const Shortcut& shortcut : shortcuts) {
+        if (shortcut.first >= arcs_.size() || shortcut.second >= arcs_.size()) {
+            throw std::invalid_argument("Shortcut refers to an unknown arc");
+        }
+        arcs_.push_back({ shortcut.from, shortcut.to,
+                          arcs_[shortcut.first].weight + arcs_[shortcut.second].weight,
+                          shortcut.first, shortcut.second });
+    }
+
+    BuildUpwardArcs();
+}
+
+
+
+template <typename Weight>
+void ContractionHierarchy<Weight>::InitializeArcs() {
+    arcs_.reserve(graph_.GetEdgeCount());
+
+    for (const Edge<Weight>& edge : graph_.GetEdges()) {
+        if (edge.weight < ZERO_WEIGHT) {
+            throw std::domain_error("Edges' weights should be non-negative");
+        }
+        arcs_.push_back({ edge.from, edge.to, edge.weight });
+    }
+}
+
+
+
+template <typename Weight>
+void ContractionHierarchy<Weight>::Contract() {
+    const size_t vertex_count = graph_.GetVertexCount();
+
+    remaining_out_arcs_.assign(vertex_count, {});
+    remaining_in_arcs_.assign(vertex_count, {});
+    contracted_.assign(vertex_count, false);
+    contracted_neighbours_.assign(vertex_count, 0);
+    witness_targets_.assign(vertex_count, false);
+
+    for (EdgeId arc_id = 0; arc_id < arcs_.size(); ++arc_id) {
+        if (arcs_[arc_id].from != arcs_[arc_id].to) {
+            remaining_out_arcs_[arcs_[arc_id].from].push_back(arc_id);
+            remaining_in_arcs_[arcs_[arc_id].to].push_back(arc_id);
+        }
+    }
+
+    using PriorityEntry = std::pair<long long, VertexId>;
+    std::priority_queue<PriorityEntry, std::vector<PriorityEntry>, std::greater<PriorityEntry>> order;
+
+    for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+        order.push({ CalculatePriority(vertex), vertex });
+    }
+
+    size_t rank = 0;
+    while (!order.empty()) {
+        const VertexId vertex = order.top().second;
+        order.pop();
+
+        if (contracted_[vertex]) {
+            continue;
+        }
+
+        // * lazy update: priorities of the remaining vertices may be outdated
+        const long long priority = CalculatePriority(vertex);
+        if (!order.empty() && priority > order.top().first) {
+            order.push({ priority, vertex });
+            continue;
+        }
+
+        ContractVertex(vertex, false);
+
+        contracted_[vertex] = true;
+        ranks_[vertex] = rank++;
+
+        for (const bool incoming : { false, true }) {
+            for (const auto& [neighbour, arc_id] : GetRemainingNeighbours(vertex, incoming)) {
+                ++contracted_neighbours_[neighbour];
+            }
+        }
+        RemoveContractedArcs(vertex);
+    }
+
+    remaining_out_arcs_.clear();
+    remaining_in_arcs_.clear();
+    contracted_.clear();
+    contracted_neighbours_.clear();
+    witness_targets_.clear();
+}
+
+
+
+template <typename Weight>
+void ContractionHierarchy<Weight>::RemoveContractedArcs(VertexId vertex) {
+    for (const EdgeId arc_id : remaining_out_arcs_[vertex]) {
+        auto& in_arcs = remaining_in_arcs_[arcs_[arc_id].to];
+        in_arcs.erase(std::remove_if(in_arcs.begin(), in_arcs.end(), [this, vertex](EdgeId id) {
+            return arcs_[id].from == vertex;
+        }), in_arcs.end());
+    }
+    for (const EdgeId arc_id : remaining_in_arcs_[vertex]) {
+        auto& out_arcs = remaining_out_arcs_[arcs_[arc_id].from];
+        out_arcs.erase(std::remove_if(out_arcs.begin(), out_arcs.end(), [this, vertex](EdgeId id) {
+            return arcs_[id].to == vertex;
+        }), out_arcs.end());
+    }
+
+    remaining_out_arcs_[vertex].clear();
+    remaining_in_arcs_[vertex].clear();
+}
+
+
+
+template <typename Weight>
+std::vector<std::pair<VertexId, EdgeId>> ContractionHierarchy<Weight>::GetRemainingNeighbours(VertexId vertex, bool incoming) const {
+    std::vector<std::pair<VertexId, EdgeId>> result;
+
+    for (const EdgeId arc_id : (incoming ? remaining_in_arcs_ : remaining_out_arcs_)[vertex]) {
+        const VertexId neighbour = incoming ? arcs_[arc_id].from : arcs_[arc_id].to;
+        if (!contracted_[neighbour]) {
+            result.push_back({ neighbour, arc_id });
+        }
+    }
+
+    std::sort(result.begin(), result.end(), [this](const auto& lhs, const auto& rhs) {
+        return lhs.first != rhs.first ? lhs.first < rhs.first : arcs_[lhs.second].weight < arcs_[rhs.second].weight;
+    });
+    result.erase(std::unique(result.begin(), result.end(), [](const auto& lhs, const auto& rhs) {
+        return lhs.first == rhs.first;
+    }), result.end());
+
+    return result;
+}
+
+
+
+template <typename Weight>
+size_t ContractionHierarchy<Weight>::ContractVertex(VertexId vertex, bool simulate) {
+    const auto in_neighbours = GetRemainingNeighbours(vertex, true);
+    const auto out_neighbours = GetRemainingNeighbours(vertex, false);
+
+    if (in_neighbours.empty() || out_neighbours.empty()) {
+        return 0;
+    }
+
+    // * a witness can only reach neighbours that have an incoming arc from somewhere else
+    Weight max_out_weight = ZERO_WEIGHT;
+    size_t witness_target_count = 0;
+    for (const auto& [to, out_arc] : out_neighbours) {
+        if (max_out_weight < arcs_[out_arc].weight) {
+            max_out_weight = arcs_[out_arc].weight;
+        }
+
+        for (const EdgeId arc_id : remaining_in_arcs_[to]) {
+            if (arcs_[arc_id].from != vertex && !contracted_[arcs_[arc_id].from]) {
+                witness_targets_[to] = true;
+                ++witness_target_count;
+                break;
+            }
+        }
+    }
+
+    size_t shortcut_count = 0;
+
+    for (const auto& [from, in_arc] : in_neighbours) {
+        forward_.Reset();
+        if (witness_target_count > 0) {
+            RunWitnessSearch(from, vertex, arcs_[in_arc].weight + max_out_weight, witness_target_count);
+        }
+
+        for (const auto& [to, out_arc] : out_neighbours) {
+            if (to == from) {
+                continue;
+            }
+
+            const Weight path_weight = arcs_[in_arc].weight + arcs_[out_arc].weight;
+            const std::optional<Weight>& witness_weight = forward_.weights[to];
+            if (witness_weight && *witness_weight <= path_weight) {
+                continue;
+            }
+
+            ++shortcut_count;
+            if (!simulate) {
+                arcs_.push_back({ from, to, path_weight, in_arc, out_arc });
+                remaining_out_arcs_[from].push_back(arcs_.size() - 1);
+                remaining_in_arcs_[to].push_back(arcs_.size() - 1);
+            }
+        }
+    }
+
+    forward_.Reset();
+    for (const auto& [to, out_arc] : out_neighbours) {
+        witness_targets_[to] = false;
+    }
+
+    return shortcut_count;
+}
+
+
+
+template <typename Weight>
+void ContractionHierarchy<Weight>::RunWitnessSearch(VertexId source, VertexId excluded, Weight limit, size_t target_count) {
+    forward_.Push(source, ZERO_WEIGHT, NO_ARC);
+
+    size_t settled_count = 0;
+    while (!forward_.queue.empty() && settled_count < WITNESS_SEARCH_SETTLED_LIMIT && target_count > 0) {
+        const QueueEntry current = forward_.Pop();
+
+        if (forward_.settled[current.vertex]) {
+            continue;
+        }
+        if (limit < current.weight) {
+            break;
+        }
+        forward_.settled[current.vertex] = true;
+        ++settled_count;
+        if (witness_targets_[current.vertex]) {
+            --target_count;
+        }
+
+        for (const EdgeId arc_id : remaining_out_arcs_[current.vertex]) {
+            const Arc& arc = arcs_[arc_id];
+            if (arc.to == excluded || contracted_[arc.to] || forward_.settled[arc.to]) {
+                continue;
+            }
+
+            const Weight candidate_weight = current.weight + arc.weight;
+            if (limit < candidate_weight) {
+                continue;
+            }
+            if (!forward_.weights[arc.to] || candidate_weight < *forward_.weights[arc.to]) {
+                forward_.Push(arc.to, candidate_weight, arc_id);
+            }
+        }
+    }
+}
+
+
+
+template <typename Weight>
+long long ContractionHierarchy<Weight>::CalculatePriority(VertexId vertex) {
+    const long long shortcut_count = static_cast<long long>(ContractVertex(vertex, true));
+    const long long removed_count = static_cast<long long>(GetRemainingNeighbours(vertex, true).size()
+                                                         + GetRemainingNeighbours(vertex, false).size());
+
+    return shortcut_count - removed_count + static_cast<long long>(contracted_neighbours_[vertex]);
+}
+
+
+
+template <typename Weight>
+void ContractionHierarchy<Weight>::BuildUpwardArcs() {
+    upward_out_arcs_.assign(graph_.GetVertexCount(), {});
+    upward_in_arcs_.assign(graph_.GetVertexCount(), {});
+
+    for (EdgeId arc_id = 0; arc_id < arcs_.size(); ++arc_id) {
+        const Arc& arc = arcs_[arc_id];
+        if (ranks_[arc.from] < ranks_[arc.to]) {
+            upward_out_arcs_[arc.from].push_back(arc_id);
+        }
+        else if (ranks_[arc.from] > ranks_[arc.to]) {
+            upward_in_arcs_[arc.to].push_back(arc_id);
+        }
+    }
+}
+
+
+
+template <typename Weight>
+std::optional<typename ContractionHierarchy<Weight>::RouteInfo> ContractionHierarchy<Weight>::BuildRoute(VertexId from,
+                                                                                                         VertexId to) const {
+    if (from >= graph_.GetVertexCount() || to >= graph_.GetVertexCount()) {
+        throw std::out_of_range("Vertex id is out of range");
+    }
+    if (from == to) {
+        return RouteInfo{ ZERO_WEIGHT, {} };
+    }
+
+    forward_.Reset();
+    backward_.Reset();
+    forward_.Push(from, ZERO_WEIGHT, NO_ARC);
+    backward_.Push(to, ZERO_WEIGHT, NO_ARC);
+
+    std::optional<Weight> best_weight;
+    VertexId meeting_vertex = 0;
+
+    while (!forward_.queue.empty() || !backward_.queue.empty()) {
+        // * a direction is finished once it cannot improve the best route found
+        if (best_weight && !forward_.queue.empty() && !(forward_.queue.front().weight < *best_weight)) {
+            forward_.queue.clear();
+        }
+        if (best_weight && !backward_.queue.empty() && !(backward_.queue.front().weight < *best_weight)) {
+            backward_.queue.clear();
+        }
+
+        if (!forward_.queue.empty()
+            && (backward_.queue.empty() || forward_.queue.front().weight <= backward_.queue.front().weight)) {
+            SettleForward(best_weight, meeting_vertex);
+        }
+        else if (!backward_.queue.empty()) {
+            SettleBackward(best_weight, meeting_vertex);
+        }
+    }
+
+    if (!best_weight) {
+        return std::nullopt;
+    }
+
+    std::vector<EdgeId> arcs;
+    for (EdgeId arc_id = forward_.parent_arcs[meeting_vertex]; arc_id != NO_ARC; arc_id = forward_.parent_arcs[arcs_[arc_id].from]) {
+        arcs.push_back(arc_id);
+    }
+    std::reverse(arcs.begin(), arcs.end());
+    for (EdgeId arc_id = backward_.parent_arcs[meeting_vertex]; arc_id != NO_ARC; arc_id = backward_.parent_arcs[arcs_[arc_id].to]) {
+        arcs.push_back(arc_id);
+    }
+
+    std::vector<EdgeId> edges;
+    for (const EdgeId arc_id : arcs) {
+        UnpackArc(arc_id, edges);
+    }
+
+    return RouteInfo{ *forward_.weights[meeting_vertex] + *backward_.weights[meeting_vertex], std::move(edges) };
+}
+
+
+
+template <typename Weight>
+void ContractionHierarchy<Weight>::SettleForward(std::optional<Weight>& best_weight, VertexId& meeting_vertex) const {
+    const QueueEntry current = forward_.Pop();
+    if (forward_.settled[current.vertex]) {
+        return;
+    }
+    forward_.settled[current.vertex] = true;
+
+    if (const auto& backward_weight = backward_.weights[current.vertex]) {
+        const Weight candidate_weight = current.weight + *backward_weight;
+        if (!best_weight || candidate_weight < *best_weight) {
+            best_weight = candidate_weight;
+            meeting_vertex = current.vertex;
+        }
+    }
+
+    for (const EdgeId arc_id : upward_out_arcs_[current.vertex]) {
+        const Arc& arc = arcs_[arc_id];
+        const Weight candidate_weight = current.weight + arc.weight;
+        if (!forward_.settled[arc.to] && (!forward_.weights[arc.to] || candidate_weight < *forward_.weights[arc.to])) {
+            forward_.Push(arc.to, candidate_weight, arc_id);
+        }
+    }
+}
+
+template <typename Weight>
+void ContractionHierarchy<Weight>::SettleBackward(std::optional<Weight>& best_weight, VertexId& meeting_vertex) const {
+    const QueueEntry current = backward_.Pop();
+    if (backward_.settled[current.vertex]) {
+        return;
+    }
+    backward_.settled[current.vertex] = true;
+
+    if (const auto& forward_weight = forward_.weights[current.vertex]) {
+        const Weight candidate_weight = *forward_weight + current.weight;
+        if (!best_weight || candidate_weight < *best_weight) {
+            best_weight = candidate_weight;
+            meeting_vertex = current.vertex;
+        }
+    }
+
+    for (const EdgeId arc_id : upward_in_arcs_[current.vertex]) {
+        const Arc& arc = arcs_[arc_id];
+        const Weight candidate_weight = arc.weight + current.weight;
+        if (!backward_.settled[arc.from] && (!backward_.weights[arc.from] || candidate_weight < *backward_.weights[arc.from])) {
+            backward_.Push(arc.from, candidate_weight, arc_id);
+        }
+    }
+}
+
+
+
+template <typename Weight>
+void ContractionHierarchy<Weight>::UnpackArc(EdgeId arc_id, std::vector<EdgeId>& edges) const {
+    std::vector<EdgeId> stack{ arc_id };
+
+    while (!stack.empty()) {
+        const Arc& arc = arcs_[stack.back()];
+        const EdgeId current_arc_id = stack.back();
+        stack.pop_back();
+
+        if (arc.first == NO_ARC) {
+            edges.push_back(current_arc_id);
+        }
+        else {
+            stack.push_back(arc.second);
+            stack.push_back(arc.first);
+        }
+    }
+}
+
+
+
+template <typename Weight>
+const std::vector<size_t>& ContractionHierarchy<Weight>::GetRanks() const {
+    return ranks_;
+}
+
+template <typename Weight>
+std::vector<typename ContractionHierarchy<Weight>::Shortcut> ContractionHierarchy<Weight>::GetShortcuts() const {
+    std::vector<Shortcut> result;
+    result.reserve(arcs_.size() - graph_.GetEdgeCount());
+
+    for (EdgeId arc_id = graph_.GetEdgeCount(); arc_id < arcs_.size(); ++arc_id) {
+        result.push_back({ arcs_[arc_id].from, arcs_[arc_id].to, arcs_[arc_id].first, arcs_[arc_id].second });
+    }
+
+    return result;
+}
+
+}  // namespace graph
@@ -0,0 +1,366 @@
+#pragma once
+
+#include "graph.h"
+#include "router.h"
+
+#include <algorithm>
+#include <functional>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace graph {
+
+// Answers every query with its own Dijkstra search instead of precomputing
+// the all-pairs matrix. Search buffers are kept between queries, so a single
+// instance must not be queried from several threads at once.
+// With a heuristic the search becomes A*: the heuristic has to be a consistent
+// lower bound of the remaining weight from a vertex to the target.
+template <typename Weight>
+class DijkstraRouter {
+private:
+    using Graph = DirectedWeightedGraph<Weight>;
+
+public:
+    using RouteInfo = typename Router<Weight>::RouteInfo;
+    using Heuristic = std::function<Weight(VertexId vertex, VertexId target)>;
+    // A vertex together with the weight it costs to start or to finish there.
+    using WeightedVertex = std::pair<VertexId, Weight>;
+
+    struct MultiRouteInfo {
+        // Indices of the chosen source and target in the given lists.
+        size_t source_index;
+        size_t target_index;
+        // The weight includes the weights of the source and the target.
+        RouteInfo route;
+    };
+
+    explicit DijkstraRouter(const Graph& graph);
+    explicit DijkstraRouter(const Graph& graph, Heuristic heuristic);
+
+    std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const;
+    // One search from the source settles all the targets: a route per target,
+    // in the order of targets. The heuristic is not used here.
+    std::vector<std::optional<RouteInfo>> BuildRoutes(VertexId from, const std::vector<VertexId>& targets) const;
+    // Calls visitor(vertex, weight) for every vertex within the budget from the
+    // source, in non-decreasing order of weight. The search stops at the first
+    // vertex over the budget.
+    template <typename Visitor>
+    void VisitReachable(VertexId from, const Weight& budget, Visitor visitor) const;
+    // The best route over all the pairs of a source and a target, found with one
+    // search started from all the sources at once. The heuristic is not used here.
+    std::optional<MultiRouteInfo> BuildRoute(const std::vector<WeightedVertex>& sources,
+                                             const std::vector<WeightedVertex>& targets) const;
+
+private:
+    struct QueueEntry {
+        Weight estimate;
+        Weight weight;
+        VertexId vertex;
+
+        bool operator>(const QueueEntry& other) const {
+            return estimate > other.estimate;
+        }
+    };
+
+    // Settles vertices in the order of their estimates until is_done(vertex) holds
+    // for a settled vertex. Without a target the estimate is the weight itself.
+    template <typename IsDone>
+    void Search(VertexId from, std::optional<VertexId> target, IsDone is_done) const;
+    // Puts a source to the queue of a search with the given start weight.
+    void AddSource(VertexId from, const Weight& weight, std::optional<VertexId> target) const;
+    // Runs a search whose sources are already in the queue.
+    template <typename IsDone>
+    void RunSearch(std::optional<VertexId> target, IsDone is_done) const;
+
+    RouteInfo ExtractRoute(VertexId to) const;
+
+    Weight Estimate(Weight weight, VertexId vertex, std::optional<VertexId> target) const;
+
+    void ResetBuffers() const;
+
+    static constexpr Weight ZERO_WEIGHT{};
+    const Graph& graph_;
+    Heuristic heuristic_;
+
+    mutable std::vector<std::optional<Weight>> weights_;
+    mutable std::vector<std::optional<EdgeId>> prev_edges_;
+    mutable std::vector<bool> settled_;
+    mutable std::vector<VertexId> touched_vertices_;
+    mutable std::vector<QueueEntry> queue_;
+};
+
+
+
+
+
+template <typename Weight>
+DijkstraRouter<Weight>::DijkstraRouter(const Graph& graph)
+    : graph_(graph)
+    , weights_(graph.GetVertexCount())
+    , prev_edges_(graph.GetVertexCount())
+    , settled_(graph.GetVertexCount(), false)
+{
+    if (!graph.IsFinalized()) {
+        throw std::invalid_argument("The graph should be finalized");
+    }
+    for (const Edge<Weight>& edge : graph.GetEdges()) {
+        if (edge.weight < ZERO_WEIGHT) {
+            throw std::domain_error("Edges' weights should be non-negative");
+        }
+    }
+}
+
+template <typename Weight>
+DijkstraRouter<Weight>::DijkstraRouter(const Graph& graph, Heuristic heuristic)
+    : DijkstraRouter(graph)
+{
+    heuristic_ = std::move(heuristic);
+}
+
+
+
+template <typename Weight>
+std::optional<typename DijkstraRouter<Weight>::RouteInfo> DijkstraRouter<Weight>::BuildRoute(VertexId from,
+                                                                                             VertexId to) const {
+    if (from >= graph_.GetVertexCount() || to >= graph_.GetVertexCount()) {
+        throw std::out_of_range("Vertex id is out of range");
+    }
+
+    Search(from, to, [to](VertexId vertex) { return vertex == to; });
+
+    if (!settled_[to]) {
+        return std::nullopt;
+    }
+
+    return ExtractRoute(to);
+}
+
+template <typename Weight>
+std::vector<std::optional<typename DijkstraRouter<Weight>::RouteInfo>> DijkstraRouter<Weight>::BuildRoutes(
+    VertexId from, const std::vector<VertexId>& targets) const {
+    if (from >= graph_.GetVertexCount()) {
+        throw std::out_of_range("Vertex id is out of range");
+    }
+
+    std::vector<VertexId> pending_targets = targets;
+    for (const VertexId target : pending_targets) {
+        if (target >= graph_.GetVertexCount()) {
+            throw std::out_of_range("Vertex id is out of range");
+        }
+    }
+    std::sort(pending_targets.begin(), pending_targets.end());
+    pending_targets.erase(std::unique(pending_targets.begin(), pending_targets.end()), pending_targets.end());
+
+    size_t pending_count = pending_targets.size();
+    if (pending_count != 0) {
+        Search(from, std::nullopt, [&pending_targets, &pending_count](VertexId vertex) {
+            if (std::binary_search(pending_targets.begin(), pending_targets.end(), vertex)) {
+                --pending_count;
+            }
+            return pending_count == 0;
+        });
+    }
+
+    std::vector<std::optional<RouteInfo>> result;
+    result.reserve(targets.size());
+    for (const VertexId target : targets) {
+        if (settled_[target]) {
+            result.push_back(ExtractRoute(target));
+        }
+        else {
+            result.push_back(std::nullopt);
+        }
+    }
+
+    return result;
+}
+
+
+
+template <typename Weight>
+template <typename Visitor>
+void DijkstraRouter<Weight>::VisitReachable(VertexId from, const Weight& budget, Visitor visitor) const {
+    if (from >= graph_.GetVertexCount()) {
+        throw std::out_of_range("Vertex id is out of range");
+    }
+
+    Search(from, std::nullopt, [this, &budget, &visitor](VertexId vertex) {
+        const Weight& weight = *weights_[vertex];
+        if (budget < weight) {
+            return true;
+        }
+        visitor(vertex, weight);
+        return false;
+    });
+}
+
+
+
+template <typename Weight>
+std::optional<typename DijkstraRouter<Weight>::MultiRouteInfo> DijkstraRouter<Weight>::BuildRoute(
+    const std::vector<WeightedVertex>& sources, const std::vector<WeightedVertex>& targets) const {
+    for (const auto& [vertex, weight] : sources) {
+        if (vertex >= graph_.GetVertexCount()) {
+            throw std::out_of_range("Vertex id is out of range");
+        }
+    }
+
+    // Target indices sorted by vertex, so that a settled vertex is looked up by a binary search.
+    std::vector<size_t> target_order(targets.size());
+    for (size_t i = 0; i < targets.size(); ++i) {
+        if (targets[i].first >= graph_.GetVertexCount()) {
+            throw std::out_of_range("Vertex id is out of range");
+        }
+        target_order[i] = i;
+    }
+    std::sort(target_order.begin(), target_order.end(), [&targets](size_t lhs, size_t rhs) {
+        return targets[lhs].first < targets[rhs].first;
+    });
+
+    if (sources.empty() || targets.empty()) {
+        return std::nullopt;
+    }
+
+    ResetBuffers();
+    for (const auto& [vertex, weight] : sources) {
+        AddSource(vertex, weight, std::nullopt);
+    }
+
+    // A settled vertex is final, so the search stops once its weight alone
+    // reaches the best total found: the weights of the targets are non-negative.
+    std::optional<Weight> best_weight;
+    std::optional<size_t> best_target;
+    RunSearch(std::nullopt, [&](VertexId vertex) {
+        const Weight& weight = *weights_[vertex];
+        if (best_weight && !(weight < *best_weight)) {
+            return true;
+        }
+
+        auto it = std::lower_bound(target_order.begin(), target_order.end(), vertex, [&targets](size_t index, VertexId value) {
+            return targets[index].first < value;
+        });
+        for (; it != target_order.end() && targets[*it].first == vertex; ++it) {
+            const Weight total_weight = weight + targets[*it].second;
+            if (!best_weight || total_weight < *best_weight) {
+                best_weight = total_weight;
+                best_target = *it;
+            }
+        }
+        return false;
+    });
+
+    if (!best_target) {
+        return std::nullopt;
+    }
+
+    RouteInfo route = ExtractRoute(targets[*best_target].first);
+    route.weight = *best_weight;
+
+    // The route starts at the source whose start weight it was settled with.
+    const VertexId first_vertex = route.edges.empty() ? targets[*best_target].first : graph_.GetEdge(route.edges.front()).from;
+    const Weight first_weight = *weights_[first_vertex];
+    size_t source_index = 0;
+    while (sources[source_index].first != first_vertex || first_weight < sources[source_index].second) {
+        ++source_index;
+    }
+
+    return MultiRouteInfo{ source_index, *best_target, std::move(route) };
+}
+
+
+
+template <typename Weight>
+template <typename IsDone>
+void DijkstraRouter<Weight>::Search(VertexId from, std::optional<VertexId> target, IsDone is_done) const {
+    ResetBuffers();
+    AddSource(from, ZERO_WEIGHT, target);
+    RunSearch(target, is_done);
+}
+
+template <typename Weight>
+void DijkstraRouter<Weight>::AddSource(VertexId from, const Weight& weight, std::optional<VertexId> target) const {
+    auto& from_weight = weights_[from];
+    if (from_weight && !(weight < *from_weight)) {
+        return;
+    }
+    if (!from_weight) {
+        touched_vertices_.push_back(from);
+    }
+    from_weight = weight;
+    queue_.push_back({ Estimate(weight, from, target), weight, from });
+    std::push_heap(queue_.begin(), queue_.end(), std::greater<QueueEntry>{});
+}
+
+template <typename Weight>
+template <typename IsDone>
+void DijkstraRouter<Weight>::RunSearch(std::optional<VertexId> target, IsDone is_done) const {
+    while (!queue_.empty()) {
+        std::pop_heap(queue_.begin(), queue_.end(), std::greater<QueueEntry>{});
+        const QueueEntry current = queue_.back();
+        queue_.pop_back();
+
+        if (settled_[current.vertex]) {
+            continue;
+        }
+        settled_[current.vertex] = true;
+
+        if (is_done(current.vertex)) {
+            break;
+        }
+
+        for (const EdgeId edge_id : graph_.GetIncidentEdges(current.vertex)) {
+            const auto& edge = graph_.GetEdge(edge_id);
+            if (settled_[edge.to]) {
+                continue;
+            }
+
+            const Weight candidate_weight = current.weight + edge.weight;
+            auto& weight = weights_[edge.to];
+            if (!weight) {
+                touched_vertices_.push_back(edge.to);
+            }
+            if (!weight || candidate_weight < *weight) {
+                weight = candidate_weight;
+                prev_edges_[edge.to] = edge_id;
+                queue_.push_back({ Estimate(candidate_weight, edge.to, target), candidate_weight, edge.to });
+                std::push_heap(queue_.begin(), queue_.end(), std::greater<QueueEntry>{});
+            }
+        }
+    }
+}
+
+template <typename Weight>
+typename DijkstraRouter<Weight>::RouteInfo DijkstraRouter<Weight>::ExtractRoute(VertexId to) const {
+    std::vector<EdgeId> edges;
+    for (std::optional<EdgeId> edge_id = prev_edges_[to];
+         edge_id;
+         edge_id = prev_edges_[graph_.GetEdge(*edge_id).from])
+    {
+        edges.push_back(*edge_id);
+    }
+    std::reverse(edges.begin(), edges.end());
+
+    return RouteInfo{ *weights_[to], std::move(edges) };
+}
+
+
+
+template <typename Weight>
+Weight DijkstraRouter<Weight>::Estimate(Weight weight, VertexId vertex, std::optional<VertexId> target) const {
+    return heuristic_ && target ? weight + heuristic_(vertex, *target) : weight;
+}
+
+template <typename Weight>
+void DijkstraRouter<Weight>::ResetBuffers() const {
+    for (const VertexId vertex : touched_vertices_) {
+        weights_[vertex].reset();
+        prev_edges_[vertex].reset();
+        settled_[vertex] = false;
+    }
+    touched_vertices_.clear();
+    queue_.clear();
+}
+
+}  // namespace graph
@@ -0,0 +1,160 @@
+#pragma once
+
+#include "domain.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <utility>
+#include <vector>
+
+namespace transport_catalogue {
+
+	// road distances keyed by a pair of stop ids: an open addressing table with linear probing,
+	// both ids are packed in one 64-bit key, so a lookup is an integer mix and a short scan of adjacent slots
+	class DistanceTable {
+	public:
+		struct Entry {
+			std::pair<StopId, StopId> stops;
+			double distance = 0.;
+		};
+
+		class Iterator {
+		public:
+			using iterator_category = std::forward_iterator_tag;
+			using value_type = Entry;
+			using difference_type = std::ptrdiff_t;
+			using pointer = void;
+			using reference = Entry;
+
+			Iterator(const DistanceTable& table, size_t slot)
+				: table_(&table)
+				, slot_(slot) {
+				SkipEmptySlots();
+			}
+
+			Entry operator*() const {
+				const uint64_t key = table_->keys_[slot_];
+				return { { static_cast<StopId>(key >> 32), static_cast<StopId>(key) }, table_->distances_[slot_] };
+			}
+
+			Iterator& operator++() {
+				++slot_;
+				SkipEmptySlots();
+				return *this;
+			}
+
+			bool operator==(const Iterator& other) const {
+				return slot_ == other.slot_;
+			}
+			bool operator!=(const Iterator& other) const {
+				return slot_ != other.slot_;
+			}
+
+		private:
+			void SkipEmptySlots() {
+				while (slot_ < table_->keys_.size() && table_->keys_[slot_] == EMPTY_KEY) {
+					++slot_;
+				}
+			}
+
+			const DistanceTable* table_;
+			size_t slot_;
+		};
+
+		DistanceTable() = default;
+
+		// sets the distance, replacing the known one
+		void Set(StopId from, StopId to, double distance) {
+			distances_[FindSlotForInsert(from, to)] = distance;
+		}
+
+		const double* Find(StopId from, StopId to) const {
+			if (keys_.empty()) {
+				return nullptr;
+			}
+
+			const uint64_t key = MakeKey(from, to);
+			for (size_t slot = Mix(key) & (keys_.size() - 1);; slot = (slot + 1) & (keys_.size() - 1)) {
+				if (keys_[slot] == key) {
+					return &distances_[slot];
+				}
+				if (keys_[slot] == EMPTY_KEY) {
+					return nullptr;
+				}
+			}
+		}
+
+		size_t Size() const {
+			return size_;
+		}
+
+		Iterator begin() const {
+			return Iterator(*this, 0);
+		}
+		Iterator end() const {
+			return Iterator(*this, keys_.size());
+		}
+
+	private:
+		static constexpr uint64_t EMPTY_KEY = std::numeric_limits<uint64_t>::max();
+		static constexpr size_t MIN_CAPACITY = 16;
+
+		static uint64_t MakeKey(StopId from, StopId to) {
+			return (static_cast<uint64_t>(from) << 32) | to;
+		}
+
+		// finalizer of splitmix64: neighbouring ids land far apart
+		static size_t Mix(uint64_t key) {
+			key = (key ^ (key >> 30)) * 0xbf58476d1ce4e5b9ULL;
+			key = (key ^ (key >> 27)) * 0x94d049bb133111ebULL;
+			return static_cast<size_t>(key ^ (key >> 31));
+		}
+
+		// the slot of the key, a new key takes an empty slot; the table stays at most half full
+		size_t FindSlotForInsert(StopId from, StopId to) {
+			if ((size_ + 1) * 2 > keys_.size()) {
+				Rehash(std::max(MIN_CAPACITY, keys_.size() * 2));
+			}
+
+			const uint64_t key = MakeKey(from, to);
+			for (size_t slot = Mix(key) & (keys_.size() - 1);; slot = (slot + 1) & (keys_.size() - 1)) {
+				if (keys_[slot] == key) {
+					return slot;
+				}
+				if (keys_[slot] == EMPTY_KEY) {
+					keys_[slot] = key;
+					++size_;
+					return slot;
+				}
+			}
+		}
+
+		void Rehash(size_t capacity) {
+			std::vector<uint64_t> keys(capacity, EMPTY_KEY);
+			std::vector<double> distances(capacity);
+
+			for (size_t old_slot = 0; old_slot < keys_.size(); ++old_slot) {
+				if (keys_[old_slot] == EMPTY_KEY) {
+					continue;
+				}
+				size_t slot = Mix(keys_[old_slot]) & (capacity - 1);
+				while (keys[slot] != EMPTY_KEY) {
+					slot = (slot + 1) & (capacity - 1);
+				}
+				keys[slot] = keys_[old_slot];
+				distances[slot] = distances_[old_slot];
+			}
+
+			keys_ = std::move(keys);
+			distances_ = std::move(distances);
+		}
+
+		std::vector<uint64_t> keys_;
+		std::vector<double> distances_;
+		size_t size_ = 0;
+	};
+
+}
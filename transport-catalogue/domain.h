@@ -2,7 +2,9 @@
 
 
 #include "geo.h"
+#include "ranges.h"
 
+#include <cstdint>
 #include <string>
 #include <string_view>
 #include <vector>
@@ -12,19 +14,35 @@
 
 namespace transport_catalogue {
 
+	// порядковые номера остановок и маршрутов в базе, задаются при добавлении
+	using StopId = uint32_t;
+	using BusId = uint32_t;
+
+	//имена остановок и маршрутов принадлежат пулу строк базы (StringPool), здесь только их представления
 	struct Stop {
-		std::string name;
+		std::string_view name;
 		geo::Coordinates coordinates;
+		StopId id = 0;
 
 		bool operator==(const Stop& rhs) const;
 	};
 
+	//статистика маршрута, считается при добавлении маршрута и пересчитывается при изменении его дистанций
+	struct BusStats {
+		size_t stops_count = 0;
+		size_t unique_stops_count = 0;
+		double route_length = 0.0;
+		double curvature = 0.0;
+	};
+
 	struct Bus {
-		std::string name;
+		std::string_view name;
 		std::unordered_set<Stop*> stops;
 		std::vector<std::pair<Stop*, Stop*>> keys_for_distance;
 		double geo_distance = 0.0;
 		bool is_ring_route = false;
+		BusId id = 0;
+		BusStats stats;
 
 		std::vector<Stop*> GetStops() const;
 
@@ -48,5 +66,6 @@ namespace transport_catalogue {
 		double curvature = 0.0;
 	};
 
-	using StopsBuses = std::set<std::string_view>;
+	//номера маршрутов остановки, представление индекса базы
+	using StopsBuses = ranges::Range<const BusId*>;
 }
\ No newline at end of file
@@ -1,6 +1,7 @@
 #define _USE_MATH_DEFINES
 #include "geo.h"
 
+#include <algorithm>
 #include <cmath>
 
 namespace geo {
@@ -17,4 +18,89 @@ namespace geo {
             * earth_radius;
     }
 
+    PreparedCoordinates PrepareCoordinates(Coordinates coordinates) {
+        static const double dr = M_PI / 180.;
+        return { std::sin(coordinates.lat * dr), std::cos(coordinates.lat * dr), coordinates.lng * dr };
+    }
+
+    double ComputeDistance(const PreparedCoordinates& from, const PreparedCoordinates& to) {
+        using namespace std;
+        const int earth_radius = 6371000;
+        const double cos_angle = from.sin_lat * to.sin_lat + from.cos_lat * to.cos_lat * cos(abs(from.lng - to.lng));
+        return acos(clamp(cos_angle, -1., 1.)) * earth_radius;
+    }
+
+    namespace {
+        const double EARTH_RADIUS = 6371000.;
+
+        // * синус половины разности углов по синусам и косинусам их половин
+        inline double SinHalfDifference(double sin_half_from, double cos_half_from, double sin_half_to, double cos_half_to) {
+            return sin_half_to * cos_half_from - cos_half_to * sin_half_from;
+        }
+
+        // * на месте гаверсинусов - расстояния; отдельный проход, чтобы цикл с арифметикой векторизовался
+        void HaversinesToDistances(std::vector<double>& values) {
+            for (double& value : values) {
+                value = 2. * EARTH_RADIUS * std::asin(std::sqrt(std::clamp(value, 0., 1.)));
+            }
+        }
+    }
+
+    HalfAngleCoordinates PrepareHalfAngles(Coordinates coordinates) {
+        static const double dr = M_PI / 180.;
+        const double half_lat = coordinates.lat * dr / 2.;
+        const double half_lng = coordinates.lng * dr / 2.;
+
+        return { std::sin(half_lat), std::cos(half_lat), std::cos(coordinates.lat * dr), std::sin(half_lng), std::cos(half_lng) };
+    }
+
+    void CoordinatesBatch::Add(Coordinates coordinates) {
+        const HalfAngleCoordinates prepared = PrepareHalfAngles(coordinates);
+
+        sin_half_lat_.push_back(prepared.sin_half_lat);
+        cos_half_lat_.push_back(prepared.cos_half_lat);
+        cos_lat_.push_back(prepared.cos_lat);
+        sin_half_lng_.push_back(prepared.sin_half_lng);
+        cos_half_lng_.push_back(prepared.cos_half_lng);
+    }
+
+    size_t CoordinatesBatch::Size() const {
+        return cos_lat_.size();
+    }
+
+    void CoordinatesBatch::ComputeDistances(const HalfAngleCoordinates& from, size_t begin, size_t end, std::vector<double>& distances) const {
+        distances.resize(end - begin);
+        for (size_t i = begin; i < end; ++i) {
+            const double sin_half_dlat = SinHalfDifference(from.sin_half_lat, from.cos_half_lat, sin_half_lat_[i], cos_half_lat_[i]);
+            const double sin_half_dlng = SinHalfDifference(from.sin_half_lng, from.cos_half_lng, sin_half_lng_[i], cos_half_lng_[i]);
+            distances[i - begin] = sin_half_dlat * sin_half_dlat + from.cos_lat * cos_lat_[i] * sin_half_dlng * sin_half_dlng;
+        }
+        HaversinesToDistances(distances);
+    }
+
+    double CoordinatesBatch::ComputeDistance(size_t from, size_t to) const {
+        const double sin_half_dlat = SinHalfDifference(sin_half_lat_[from], cos_half_lat_[from], sin_half_lat_[to], cos_half_lat_[to]);
+        const double sin_half_dlng = SinHalfDifference(sin_half_lng_[from], cos_half_lng_[from], sin_half_lng_[to], cos_half_lng_[to]);
+        const double haversine = sin_half_dlat * sin_half_dlat + cos_lat_[from] * cos_lat_[to] * sin_half_dlng * sin_half_dlng;
+        return 2. * EARTH_RADIUS * std::asin(std::sqrt(std::clamp(haversine, 0., 1.)));
+    }
+
+    std::vector<double> CoordinatesBatch::ComputePolylineDistances(const std::vector<uint32_t>& indices) const {
+        if (indices.size() < 2) {
+            return {};
+        }
+
+        std::vector<double> result(indices.size() - 1);
+        for (size_t i = 0; i + 1 < indices.size(); ++i) {
+            const uint32_t from = indices[i];
+            const uint32_t to = indices[i + 1];
+            const double sin_half_dlat = SinHalfDifference(sin_half_lat_[from], cos_half_lat_[from], sin_half_lat_[to], cos_half_lat_[to]);
+            const double sin_half_dlng = SinHalfDifference(sin_half_lng_[from], cos_half_lng_[from], sin_half_lng_[to], cos_half_lng_[to]);
+            result[i] = sin_half_dlat * sin_half_dlat + cos_lat_[from] * cos_lat_[to] * sin_half_dlng * sin_half_dlng;
+        }
+        HaversinesToDistances(result);
+
+        return result;
+    }
+
 }  // namespace geo
\ No newline at end of file
@@ -1,5 +1,9 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
 namespace geo {
 
     struct Coordinates {
@@ -15,4 +19,51 @@ namespace geo {
 
     double ComputeDistance(Coordinates from, Coordinates to);
 
+    // Точка с заранее посчитанными тригонометрическими значениями,
+    // для точек, участвующих во многих вычислениях расстояния
+    struct PreparedCoordinates {
+        double sin_lat = 0.;
+        double cos_lat = 0.;
+        double lng = 0.; // Долгота в радианах
+    };
+
+    PreparedCoordinates PrepareCoordinates(Coordinates coordinates);
+    double ComputeDistance(const PreparedCoordinates& from, const PreparedCoordinates& to);
+
+    // Точка с синусами и косинусами половин углов для формулы гаверсинусов
+    struct HalfAngleCoordinates {
+        double sin_half_lat = 0.;
+        double cos_half_lat = 1.;
+        double cos_lat = 1.;
+        double sin_half_lng = 0.;
+        double cos_half_lng = 1.;
+    };
+
+    HalfAngleCoordinates PrepareHalfAngles(Coordinates coordinates);
+
+    // Много точек с заранее посчитанными синусами и косинусами половин углов,
+    // каждая величина в своём массиве (SoA), чтобы пакетные расчёты шли подряд по памяти.
+    // Расстояние считается по формуле гаверсинусов: в отличие от арккосинуса
+    // она не теряет точность на коротких расстояниях, а внутренний цикл обходится без тригонометрии
+    class CoordinatesBatch {
+    public:
+        // номер точки - её индекс в порядке добавления
+        void Add(Coordinates coordinates);
+        size_t Size() const;
+
+        // расстояния от точки до точек набора с номерами [begin, end), в distances по порядку
+        void ComputeDistances(const HalfAngleCoordinates& from, size_t begin, size_t end, std::vector<double>& distances) const;
+        // расстояние между точками набора с номерами from и to
+        double ComputeDistance(size_t from, size_t to) const;
+        // расстояния между соседними точками ломаной indices[0], indices[1], ...: на одно меньше, чем точек
+        std::vector<double> ComputePolylineDistances(const std::vector<uint32_t>& indices) const;
+
+    private:
+        std::vector<double> sin_half_lat_;
+        std::vector<double> cos_half_lat_;
+        std::vector<double> cos_lat_;
+        std::vector<double> sin_half_lng_;
+        std::vector<double> cos_half_lng_;
+    };
+
 }  // namespace geo
\ No newline at end of file
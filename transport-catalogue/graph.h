@@ -3,6 +3,8 @@
 #include "ranges.h"
 
 #include <cstdlib>
+#include <numeric>
+#include <stdexcept>
 #include <vector>
 
 namespace graph {
@@ -17,30 +19,39 @@ struct Edge {
     Weight weight;
 };
 
+// Edges are added to a growing graph and Finalize() freezes it into the
+// compressed sparse row form: the edges sorted by source and the offset of
+// the first outgoing edge of every vertex. Finalize renumbers the edges and
+// returns the new id of every edge in the order of addition, so data kept
+// per edge can follow it; the incident edges are available only in the
+// frozen form.
 template <typename Weight>
 class DirectedWeightedGraph {
 private:
-    using IncidenceList = std::vector<EdgeId>;
-    using IncidentEdgesRange = ranges::Range<typename IncidenceList::const_iterator>;
+    using IncidentEdgesRange = ranges::Range<ranges::CountingIterator<EdgeId>>;
 
 public:
     DirectedWeightedGraph() = default;
     explicit DirectedWeightedGraph(size_t vertex_count);
-    explicit DirectedWeightedGraph(std::vector<Edge<Weight>>&& edges, std::vector<IncidenceList>&& incidence_lists);
+    // The frozen form: edges sorted by source and vertex_count + 1 offsets
+    explicit DirectedWeightedGraph(std::vector<Edge<Weight>>&& edges, std::vector<EdgeId>&& offsets);
 
     EdgeId AddEdge(const Edge<Weight>& edge);
+    std::vector<EdgeId> Finalize();
 
+    bool IsFinalized() const;
     size_t GetVertexCount() const;
     size_t GetEdgeCount() const;
     const Edge<Weight>& GetEdge(EdgeId edge_id) const;
     IncidentEdgesRange GetIncidentEdges(VertexId vertex) const;
 
     const std::vector<Edge<Weight>>& GetEdges() const;
-    const std::vector<IncidenceList>& GetIncidentLists() const;
+    const std::vector<EdgeId>& GetOffsets() const;
 
 private:
+    size_t vertex_count_ = 0;
     std::vector<Edge<Weight>> edges_;
-    std::vector<IncidenceList> incidence_lists_;
+    std::vector<EdgeId> offsets_;
 };
 
 
@@ -48,24 +59,78 @@ private:
 
 template <typename Weight>
 DirectedWeightedGraph<Weight>::DirectedWeightedGraph(size_t vertex_count)
-    : incidence_lists_(vertex_count) {
+    : vertex_count_(vertex_count) {
 }
 template <typename Weight>
-DirectedWeightedGraph<Weight>::DirectedWeightedGraph(std::vector<Edge<Weight>>&& edges, std::vector<IncidenceList>&& incidence_lists) 
-    : edges_(std::move(edges)), 
-    incidence_lists_(std::move(incidence_lists)) { }
+DirectedWeightedGraph<Weight>::DirectedWeightedGraph(std::vector<Edge<Weight>>&& edges, std::vector<EdgeId>&& offsets) 
+    : vertex_count_(offsets.empty() ? 0 : offsets.size() - 1),
+    edges_(std::move(edges)), 
+    offsets_(std::move(offsets))
+{
+    if (offsets_.empty() || offsets_.front() != 0 || offsets_.back() != edges_.size()) {
+        throw std::invalid_argument("Offsets do not match the edges");
+    }
+    for (VertexId vertex = 0; vertex < vertex_count_; ++vertex) {
+        if (offsets_[vertex] > offsets_[vertex + 1]) {
+            throw std::invalid_argument("Offsets do not match the edges");
+        }
+        for (EdgeId edge_id = offsets_[vertex]; edge_id < offsets_[vertex + 1]; ++edge_id) {
+            if (edges_[edge_id].from != vertex || edges_[edge_id].to >= vertex_count_) {
+                throw std::invalid_argument("Offsets do not match the edges");
+            }
+        }
+    }
+}
 
 template <typename Weight>
 EdgeId DirectedWeightedGraph<Weight>::AddEdge(const Edge<Weight>& edge) {
+    if (IsFinalized()) {
+        throw std::logic_error("Cannot add an edge to a finalized graph");
+    }
+    if (edge.from >= vertex_count_ || edge.to >= vertex_count_) {
+        throw std::out_of_range("Vertex id is out of range");
+    }
     edges_.push_back(edge);
-    const EdgeId id = edges_.size() - 1;
-    incidence_lists_.at(edge.from).push_back(id);
-    return id;
+    return edges_.size() - 1;
+}
+
+template <typename Weight>
+std::vector<EdgeId> DirectedWeightedGraph<Weight>::Finalize() {
+    std::vector<EdgeId> new_edge_ids(edges_.size());
+    if (IsFinalized()) {
+        std::iota(new_edge_ids.begin(), new_edge_ids.end(), EdgeId{ 0 });
+        return new_edge_ids;
+    }
+
+    // * a stable counting sort keeps the order of the edges of every vertex
+    offsets_.assign(vertex_count_ + 1, 0);
+    for (const Edge<Weight>& edge : edges_) {
+        ++offsets_[edge.from + 1];
+    }
+    for (VertexId vertex = 0; vertex < vertex_count_; ++vertex) {
+        offsets_[vertex + 1] += offsets_[vertex];
+    }
+
+    std::vector<EdgeId> positions(offsets_.begin(), std::prev(offsets_.end()));
+    std::vector<Edge<Weight>> sorted_edges(edges_.size());
+    for (EdgeId edge_id = 0; edge_id < edges_.size(); ++edge_id) {
+        const EdgeId new_edge_id = positions[edges_[edge_id].from]++;
+        sorted_edges[new_edge_id] = edges_[edge_id];
+        new_edge_ids[edge_id] = new_edge_id;
+    }
+    edges_ = std::move(sorted_edges);
+
+    return new_edge_ids;
+}
+
+template <typename Weight>
+bool DirectedWeightedGraph<Weight>::IsFinalized() const {
+    return !offsets_.empty();
 }
 
 template <typename Weight>
 size_t DirectedWeightedGraph<Weight>::GetVertexCount() const {
-    return incidence_lists_.size();
+    return vertex_count_;
 }
 
 template <typename Weight>
@@ -75,13 +140,15 @@ size_t DirectedWeightedGraph<Weight>::GetEdgeCount() const {
 
 template <typename Weight>
 const Edge<Weight>& DirectedWeightedGraph<Weight>::GetEdge(EdgeId edge_id) const {
-    return edges_.at(edge_id);
+    return edges_[edge_id];
 }
 
 template <typename Weight>
 typename DirectedWeightedGraph<Weight>::IncidentEdgesRange
 DirectedWeightedGraph<Weight>::GetIncidentEdges(VertexId vertex) const {
-    return ranges::AsRange(incidence_lists_.at(vertex));
+    return IncidentEdgesRange{
+        ranges::CountingIterator<EdgeId>{ offsets_[vertex] },
+        ranges::CountingIterator<EdgeId>{ offsets_[vertex + 1] } };
 }
 
 template <typename Weight>
@@ -90,8 +157,8 @@ const std::vector<Edge<Weight>>& DirectedWeightedGraph<Weight>::GetEdges() const
 }
 
 template<typename Weight>
-const std::vector<std::vector<EdgeId>>& DirectedWeightedGraph<Weight>::GetIncidentLists() const {
-    return incidence_lists_;
+const std::vector<EdgeId>& DirectedWeightedGraph<Weight>::GetOffsets() const {
+    return offsets_;
 }
 
 
@@ -0,0 +1,413 @@
+#pragma once
+
+#include "graph.h"
+#include "router.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <numeric>
+#include <optional>
+#include <stdexcept>
+#include <vector>
+
+namespace graph {
+
+// Hub labeling (2-hop cover) built by pruned landmark labeling. Every vertex
+// keeps a forward label (hubs it reaches, with the distance) and a backward
+// label (hubs that reach it). Every shortest path has a hub in both labels
+// of its ends, so the distance is one merge of two sorted arrays. Every label
+// entry also keeps the edge of its path next to the vertex, so a route is
+// unpacked on demand from the labels of the best hub, one lookup per edge.
+template <typename Weight>
+class HubLabels {
+private:
+    using Graph = DirectedWeightedGraph<Weight>;
+
+public:
+    using RouteInfo = typename Router<Weight>::RouteInfo;
+
+    // Labels of all vertices one after another: the label of the vertex v is
+    // [offsets[v], offsets[v + 1]) of hubs and weights, sorted by hub.
+    // Hubs are numbered in the order they were processed. The edge of an entry
+    // is the first edge of the path to the hub in a forward label and the last
+    // edge of the path from the hub in a backward label, NO_EDGE at the hub.
+    struct Labels {
+        std::vector<uint32_t> offsets;
+        std::vector<uint32_t> hubs;
+        std::vector<Weight> weights;
+        std::vector<uint32_t> edges;
+    };
+
+    static constexpr uint32_t NO_EDGE = std::numeric_limits<uint32_t>::max();
+
+    explicit HubLabels(const Graph& graph);
+    explicit HubLabels(const Graph& graph, Labels&& forward_labels, Labels&& backward_labels);
+
+    std::optional<Weight> GetDistance(VertexId from, VertexId to) const;
+    std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const;
+
+    const Labels& GetForwardLabels() const;
+    const Labels& GetBackwardLabels() const;
+
+private:
+    struct LabelEntry {
+        uint32_t hub;
+        Weight weight;
+        uint32_t edge;
+    };
+
+    struct QueueEntry {
+        Weight weight;
+        VertexId vertex;
+        uint32_t edge;
+
+        bool operator>(const QueueEntry& other) const {
+            return weight > other.weight;
+        }
+    };
+
+    struct HubMatch {
+        Weight weight;
+        uint32_t forward_entry;
+        uint32_t backward_entry;
+    };
+
+    // the common hub of the labels of from and to with the least sum of weights
+    std::optional<HubMatch> FindBestHub(VertexId from, VertexId to) const;
+    // the entry of the hub in the label of the vertex
+    static uint32_t FindEntry(const Labels& labels, VertexId vertex, uint32_t hub);
+
+    void BuildLabels();
+    // Dijkstra from the vertex of the hub over the edges (or the reversed edges),
+    // a vertex already covered by the labels is neither labelled nor expanded
+    void RunPrunedSearch(
+        uint32_t hub,
+        VertexId root,
+        bool backward,
+        const std::vector<std::vector<EdgeId>>& in_edges,
+        std::vector<std::vector<LabelEntry>>& root_labels,
+        std::vector<std::vector<LabelEntry>>& labels);
+
+    static Labels Flatten(std::vector<std::vector<LabelEntry>>&& labels);
+    void CheckLabels(const Labels& labels) const;
+
+    static constexpr Weight ZERO_WEIGHT{};
+    const Graph& graph_;
+
+    Labels forward_labels_;
+    Labels backward_labels_;
+
+    // * preprocessing state
+    std::vector<std::optional<Weight>> hub_weights_;
+    std::vector<std::optional<Weight>> weights_;
+    std::vector<VertexId> touched_vertices_;
+    std::vector<QueueEntry> queue_;
+};
+
+
+
+
+
+template <typename Weight>
+HubLabels<Weight>::HubLabels(const Graph& graph)
+    : graph_(graph)
+{
+    if (!graph.IsFinalized()) {
+        throw std::invalid_argument("The graph should be finalized");
+    }
+    if (graph.GetVertexCount() >= std::numeric_limits<uint32_t>::max()) {
+        throw std::length_error("Too many vertices for 32-bit hub ids");
+    }
+    if (graph.GetEdgeCount() >= NO_EDGE) {
+        throw std::length_error("Too many edges for 32-bit label edges");
+    }
+    for (const Edge<Weight>& edge : graph.GetEdges()) {
+        if (edge.weight < ZERO_WEIGHT) {
+            throw std::domain_error("Edges' weights should be non-negative");
+        }
+    }
+
+    BuildLabels();
+}
+
+template <typename Weight>
+HubLabels<Weight>::HubLabels(const Graph& graph, Labels&& forward_labels, Labels&& backward_labels)
+    : graph_(graph)
+    , forward_labels_(std::move(forward_labels))
+    , backward_labels_(std::move(backward_labels))
+{
+    CheckLabels(forward_labels_);
+    CheckLabels(backward_labels_);
+}
+
+
+
+template <typename Weight>
+std::optional<Weight> HubLabels<Weight>::GetDistance(VertexId from, VertexId to) const {
+    if (const std::optional<HubMatch> match = FindBestHub(from, to)) {
+        return match->weight;
+    }
+    return std::nullopt;
+}
+
+template <typename Weight>
+std::optional<typename HubLabels<Weight>::RouteInfo> HubLabels<Weight>::BuildRoute(VertexId from, VertexId to) const {
+    const std::optional<HubMatch> match = FindBestHub(from, to);
+    if (!match) {
+        return std::nullopt;
+    }
+
+    const uint32_t hub = forward_labels_.hubs[match->forward_entry];
+    // * a path is never longer than the vertex count, a longer walk means broken labels
+    const size_t max_edge_count = graph_.GetVertexCount();
+    std::vector<EdgeId> edges;
+
+    // * to the hub by the first edges of the forward labels
+    for (uint32_t entry = match->forward_entry; forward_labels_.edges[entry] != NO_EDGE;) {
+        const EdgeId edge_id = forward_labels_.edges[entry];
+        edges.push_back(edge_id);
+        if (edges.size() > max_edge_count) {
+            throw std::logic_error("Hub labels do not match the graph");
+        }
+        entry = FindEntry(forward_labels_, graph_.GetEdge(edge_id).to, hub);
+    }
+
+    // * from the hub by the last edges of the backward labels, the edges come in the reverse order
+    const size_t hub_position = edges.size();
+    for (uint32_t entry = match->backward_entry; backward_labels_.edges[entry] != NO_EDGE;) {
+        const EdgeId edge_id = backward_labels_.edges[entry];
+        edges.push_back(edge_id);
+        if (edges.size() > max_edge_count) {
+            throw std::logic_error("Hub labels do not match the graph");
+        }
+        entry = FindEntry(backward_labels_, graph_.GetEdge(edge_id).from, hub);
+    }
+    std::reverse(edges.begin() + hub_position, edges.end());
+
+    return RouteInfo{ match->weight, std::move(edges) };
+}
+
+
+
+template <typename Weight>
+std::optional<typename HubLabels<Weight>::HubMatch> HubLabels<Weight>::FindBestHub(VertexId from, VertexId to) const {
+    if (from >= graph_.GetVertexCount() || to >= graph_.GetVertexCount()) {
+        throw std::out_of_range("Vertex id is out of range");
+    }
+
+    uint32_t forward = forward_labels_.offsets[from];
+    const uint32_t forward_end = forward_labels_.offsets[from + 1];
+    uint32_t backward = backward_labels_.offsets[to];
+    const uint32_t backward_end = backward_labels_.offsets[to + 1];
+
+    std::optional<HubMatch> result;
+    while (forward < forward_end && backward < backward_end) {
+        const uint32_t forward_hub = forward_labels_.hubs[forward];
+        const uint32_t backward_hub = backward_labels_.hubs[backward];
+
+        if (forward_hub < backward_hub) {
+            ++forward;
+        }
+        else if (backward_hub < forward_hub) {
+            ++backward;
+        }
+        else {
+            const Weight weight = forward_labels_.weights[forward] + backward_labels_.weights[backward];
+            if (!result || weight < result->weight) {
+                result = HubMatch{ weight, forward, backward };
+            }
+            ++forward;
+            ++backward;
+        }
+    }
+
+    return result;
+}
+
+template <typename Weight>
+uint32_t HubLabels<Weight>::FindEntry(const Labels& labels, VertexId vertex, uint32_t hub) {
+    const auto begin = labels.hubs.begin() + labels.offsets[vertex];
+    const auto end = labels.hubs.begin() + labels.offsets[vertex + 1];
+
+    const auto it = std::lower_bound(begin, end, hub);
+    if (it == end || *it != hub) {
+        throw std::logic_error("Hub labels do not match the graph");
+    }
+    return static_cast<uint32_t>(it - labels.hubs.begin());
+}
+
+
+
+template <typename Weight>
+const typename HubLabels<Weight>::Labels& HubLabels<Weight>::GetForwardLabels() const {
+    return forward_labels_;
+}
+
+template <typename Weight>
+const typename HubLabels<Weight>::Labels& HubLabels<Weight>::GetBackwardLabels() const {
+    return backward_labels_;
+}
+
+
+
+template <typename Weight>
+void HubLabels<Weight>::BuildLabels() {
+    const size_t vertex_count = graph_.GetVertexCount();
+
+    std::vector<std::vector<EdgeId>> in_edges(vertex_count);
+    for (EdgeId edge_id = 0; edge_id < graph_.GetEdgeCount(); ++edge_id) {
+        in_edges[graph_.GetEdge(edge_id).to].push_back(edge_id);
+    }
+
+    // * well connected vertices first: they cover the most shortest paths and keep the labels short
+    std::vector<VertexId> order(vertex_count);
+    std::iota(order.begin(), order.end(), VertexId{ 0 });
+    auto degree_product = [this, &in_edges](VertexId vertex) {
+        const auto out_edges = graph_.GetIncidentEdges(vertex);
+        const size_t out_degree = std::distance(out_edges.begin(), out_edges.end());
+        return (out_degree + 1) * (in_edges[vertex].size() + 1);
+    };
+    std::stable_sort(order.begin(), order.end(), [&degree_product](VertexId lhs, VertexId rhs) {
+        return degree_product(lhs) > degree_product(rhs);
+    });
+
+    std::vector<std::vector<LabelEntry>> forward_labels(vertex_count);
+    std::vector<std::vector<LabelEntry>> backward_labels(vertex_count);
+
+    hub_weights_.assign(vertex_count, std::nullopt);
+    weights_.assign(vertex_count, std::nullopt);
+
+    for (uint32_t hub = 0; hub < vertex_count; ++hub) {
+        // * the forward search fills the backward labels of the reached vertices and vice versa
+        RunPrunedSearch(hub, order[hub], false, in_edges, forward_labels, backward_labels);
+        RunPrunedSearch(hub, order[hub], true, in_edges, backward_labels, forward_labels);
+    }
+
+    forward_labels_ = Flatten(std::move(forward_labels));
+    backward_labels_ = Flatten(std::move(backward_labels));
+
+    hub_weights_ = {};
+    weights_ = {};
+    touched_vertices_ = {};
+    queue_ = {};
+}
+
+template <typename Weight>
+void HubLabels<Weight>::RunPrunedSearch(
+    uint32_t hub,
+    VertexId root,
+    bool backward,
+    const std::vector<std::vector<EdgeId>>& in_edges,
+    std::vector<std::vector<LabelEntry>>& root_labels,
+    std::vector<std::vector<LabelEntry>>& labels)
+{
+    for (const LabelEntry& entry : root_labels[root]) {
+        hub_weights_[entry.hub] = entry.weight;
+    }
+
+    auto is_covered = [this, &labels](VertexId vertex, Weight weight) {
+        for (const LabelEntry& entry : labels[vertex]) {
+            if (hub_weights_[entry.hub] && *hub_weights_[entry.hub] + entry.weight <= weight) {
+                return true;
+            }
+        }
+        return false;
+    };
+
+    auto relax = [this](VertexId vertex, Weight weight, uint32_t edge) {
+        auto& current_weight = weights_[vertex];
+        if (!current_weight) {
+            touched_vertices_.push_back(vertex);
+        }
+        if (!current_weight || weight < *current_weight) {
+            current_weight = weight;
+            queue_.push_back({ weight, vertex, edge });
+            std::push_heap(queue_.begin(), queue_.end(), std::greater<QueueEntry>{});
+        }
+    };
+
+    relax(root, ZERO_WEIGHT, NO_EDGE);
+
+    while (!queue_.empty()) {
+        std::pop_heap(queue_.begin(), queue_.end(), std::greater<QueueEntry>{});
+        const QueueEntry current = queue_.back();
+        queue_.pop_back();
+
+        if (current.weight > *weights_[current.vertex] || is_covered(current.vertex, current.weight)) {
+            continue;
+        }
+        labels[current.vertex].push_back({ hub, current.weight, current.edge });
+
+        if (backward) {
+            for (const EdgeId edge_id : in_edges[current.vertex]) {
+                const Edge<Weight>& edge = graph_.GetEdge(edge_id);
+                relax(edge.from, current.weight + edge.weight, static_cast<uint32_t>(edge_id));
+            }
+        }
+        else {
+            for (const EdgeId edge_id : graph_.GetIncidentEdges(current.vertex)) {
+                const Edge<Weight>& edge = graph_.GetEdge(edge_id);
+                relax(edge.to, current.weight + edge.weight, static_cast<uint32_t>(edge_id));
+            }
+        }
+    }
+
+    for (const VertexId vertex : touched_vertices_) {
+        weights_[vertex].reset();
+    }
+    touched_vertices_.clear();
+    for (const LabelEntry& entry : root_labels[root]) {
+        hub_weights_[entry.hub].reset();
+    }
+}
+
+template <typename Weight>
+typename HubLabels<Weight>::Labels HubLabels<Weight>::Flatten(std::vector<std::vector<LabelEntry>>&& labels) {
+    Labels result;
+    result.offsets.reserve(labels.size() + 1);
+    result.offsets.push_back(0);
+
+    size_t entry_count = 0;
+    for (const auto& label : labels) {
+        entry_count += label.size();
+    }
+    if (entry_count >= std::numeric_limits<uint32_t>::max()) {
+        throw std::length_error("Too many label entries for 32-bit offsets");
+    }
+    result.hubs.reserve(entry_count);
+    result.weights.reserve(entry_count);
+    result.edges.reserve(entry_count);
+
+    for (auto& label : labels) {
+        for (const LabelEntry& entry : label) {
+            result.hubs.push_back(entry.hub);
+            result.weights.push_back(entry.weight);
+            result.edges.push_back(entry.edge);
+        }
+        result.offsets.push_back(static_cast<uint32_t>(result.hubs.size()));
+        label = {};
+    }
+
+    return result;
+}
+
+template <typename Weight>
+void HubLabels<Weight>::CheckLabels(const Labels& labels) const {
+    if (labels.offsets.size() != graph_.GetVertexCount() + 1
+        || labels.offsets.front() != 0
+        || labels.offsets.back() != labels.hubs.size()
+        || labels.hubs.size() != labels.weights.size()
+        || labels.hubs.size() != labels.edges.size()
+        || !std::is_sorted(labels.offsets.begin(), labels.offsets.end())) {
+        throw std::invalid_argument("Hub labels do not match the graph");
+    }
+    for (const uint32_t edge : labels.edges) {
+        if (edge != NO_EDGE && edge >= graph_.GetEdgeCount()) {
+            throw std::invalid_argument("Hub labels do not match the graph");
+        }
+    }
+}
+
+}  // namespace graph
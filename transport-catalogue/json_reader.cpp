@@ -8,6 +8,7 @@
 #include <sstream>
 #include <fstream>
 #include <optional>
+#include <chrono>
 
 
 namespace transport_catalogue {
@@ -17,7 +18,8 @@ namespace transport_catalogue {
         , queries_(json::Load(input).GetRoot().AsDict())
         , output_(&output)
         , catalogue_(&catalogue)
-        , router_(FillCatalogue())
+        , routing_settings_(ParseRoutingSettings())
+        , router_(FillCatalogue(), routing_settings_)
         , renderer_(*catalogue_)
     {
         if (queries_.count("render_settings")) {
@@ -28,13 +30,21 @@ namespace transport_catalogue {
     JSONReader::JSONReader(std::istream& input)
         : mode_(ReaderMode::SERIALIZATION)
         , queries_(json::Load(input).GetRoot().AsDict())
-        , router_(FillCatalogue())
+        , routing_settings_(ParseRoutingSettings())
+        , router_(FillCatalogue(), routing_settings_)
     {
         if (queries_.count("render_settings")) {
             SetRenderSettings(queries_.at("render_settings").AsDict());
         }
 
         transport_catalogue_serialize::Serialize(GetSerializationFilePath(), *catalogue_, renderer_, router_);
+
+        if (const auto* router = std::get_if<graph::Router<TransportRouter::RouteWeight>>(&router_.GetRouter())) {
+            std::clog << "Router build time: " << router->GetBuildDuration().count() << " ms" << std::endl;
+        }
+        if (routing_settings_.walking_transfer_radius > 0.) {
+            std::clog << "Walking transfer edges: " << router_.GetWalkEdgeCount() << " of " << router_.GetGraph().GetEdgeCount() << std::endl;
+        }
     }
 
 
@@ -44,11 +54,46 @@ namespace transport_catalogue {
         , deserialization_result_(transport_catalogue_serialize::Deserialize(GetSerializationFilePath()).value())
         , output_(&output)
         , catalogue_(new Catalogue(transport_catalogue_serialize::details::ConvertRawCatalogueToNormal(deserialization_result_)))
-        , graph_(transport_catalogue_serialize::details::ConvertRawGraphToNormal(deserialization_result_.router().graph(), *catalogue_))
+        , graph_(transport_catalogue_serialize::details::ConvertRawGraphToNormal(deserialization_result_.router().graph()))
         , router_(transport_catalogue_serialize::details::ConvertRawTransportRouterToNormal(deserialization_result_.router(), *catalogue_, *graph_))
         , renderer_(*catalogue_, transport_catalogue_serialize::details::ConvertRawRenderSettingsToNormal(deserialization_result_.render_settings()))
     { }
 
+    JSONReader::JSONReader(std::istream& input, UpdateMode)
+        : mode_(ReaderMode::UPDATE)
+        , queries_(json::Load(input).GetRoot().AsDict())
+        , deserialization_result_(transport_catalogue_serialize::Deserialize(GetSerializationFilePath()).value())
+        , catalogue_(new Catalogue(transport_catalogue_serialize::details::ConvertRawCatalogueToNormal(deserialization_result_)))
+        , graph_(transport_catalogue_serialize::details::ConvertRawGraphToNormal(deserialization_result_.router().graph()))
+        , router_(transport_catalogue_serialize::details::ConvertRawTransportRouterToNormal(deserialization_result_.router(), *catalogue_, *graph_))
+    {
+        using namespace std::literals;
+
+        const auto start = std::chrono::steady_clock::now();
+
+        // * the keys refer to buses by name, they have to be taken before the buses change
+        const std::vector<TransportRouter::EdgeKey> previous_edge_keys = router_.GetEdgeKeys();
+
+        UpdateCatalogue(queries_.at("update_requests"s).AsArray());
+
+        const TransportRouter router(*catalogue_, std::move(router_), previous_edge_keys);
+        const renderer::MapRenderer renderer(*catalogue_, transport_catalogue_serialize::details::ConvertRawRenderSettingsToNormal(deserialization_result_.render_settings()));
+
+        transport_catalogue_serialize::Serialize(GetSerializationFilePath(), *catalogue_, renderer, router);
+
+        std::clog << "Update time: " << std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count() << " ms" << std::endl;
+        if (router.IsEngineRepaired()) {
+            const auto& engine = std::get<graph::Router<TransportRouter::RouteWeight>>(router.GetRouter());
+            std::clog << "Repaired router rows: " << engine.GetRepairedRowCount() << " of " << engine.GetRoutesInternalData().vertex_count << std::endl;
+        }
+        else {
+            std::clog << "Router rebuilt: " << router.GetGraph().GetVertexCount() << " vertices, " << router.GetGraph().GetEdgeCount() << " edges" << std::endl;
+        }
+        if (router.GetRoutingSettings().walking_transfer_radius > 0.) {
+            std::clog << "Walking transfer edges: " << router.GetWalkEdgeCount() << " of " << router.GetGraph().GetEdgeCount() << std::endl;
+        }
+    }
+
 
 
 
@@ -57,6 +102,11 @@ namespace transport_catalogue {
 
         if (mode_ == ReaderMode::DEFAULT or mode_ == ReaderMode::DESERIALIZATION) {
             ParseStatRequests(queries_.at("stat_requests"s).AsArray());
+
+            if (const std::optional<RouteCache::Stats> stats = router_.GetRouteCacheStats()) {
+                std::clog << "Route cache: " << stats->hits << " hits, " << stats->misses << " misses, "
+                    << stats->size << " of " << stats->capacity << " entries" << std::endl;
+            }
         }
     }
 
@@ -140,12 +190,139 @@ namespace transport_catalogue {
         for (const BusQuery& bus_query : bus_queries) {
             catalogue_->AddBus(bus_query.bus_name, bus_query.stops, bus_query.is_ring_route);
         }
+        catalogue_->BuildIndexes();
 
 
 
         return *catalogue_;
     }
 
+    void JSONReader::UpdateCatalogue(const json::Array& update_requests) {
+        using namespace std::literals;
+
+        // * new stops first and distances next, so that buses and distances may refer to any stop of the update
+        for (const json::Node& node : update_requests) {
+            const json::Dict& query = node.AsDict();
+
+            if (query.at("type"s) == "Stop"s && !catalogue_->FindStop(query.at("name"s).AsString())) {
+                catalogue_->AddStop(query.at("name"s).AsString(), geo::Coordinates{ query.at("latitude"s).AsDouble(), query.at("longitude"s).AsDouble() });
+            }
+        }
+
+        for (const json::Node& node : update_requests) {
+            const json::Dict& query = node.AsDict();
+
+            if (query.at("type"s) == "Stop"s && query.count("road_distances"s)) {
+                std::unordered_map<std::string_view, double> distanses;
+                for (const auto& [stop_name, distance] : query.at("road_distances"s).AsDict()) {
+                    distanses[stop_name] = distance.AsDouble();
+                }
+                catalogue_->AddDistance(catalogue_->FindStop(query.at("name"s).AsString()), distanses);
+            }
+        }
+
+        for (const json::Node& node : update_requests) {
+            const json::Dict& query = node.AsDict();
+
+            if (query.at("type"s) == "Stop"s) {
+                continue;
+            }
+            else if (query.at("type"s) == "Bus"s) {
+                std::vector<std::string_view> stops;
+                for (const json::Node& stop : query.at("stops"s).AsArray()) {
+                    stops.push_back(stop.AsString());
+                }
+
+                catalogue_->UpdateBus(query.at("name"s).AsString(), stops, query.at("is_roundtrip"s).AsBool());
+            }
+            else if (query.at("type"s) == "RemoveBus"s) {
+                catalogue_->RemoveBus(query.at("name"s).AsString());
+            }
+            else {
+                throw std::invalid_argument("Unknown request type"s);
+            }
+        }
+
+        catalogue_->BuildIndexes();
+    }
+
+    RoutingSettings JSONReader::ParseRoutingSettings() const {
+        using namespace std::literals;
+
+        RoutingSettings result;
+
+        if (!queries_.count("routing_settings"s)) {
+            return result;
+        }
+
+        const json::Dict& routing_settings = queries_.at("routing_settings"s).AsDict();
+
+        if (routing_settings.count("router"s)) {
+            const std::string& router_type = routing_settings.at("router"s).AsString();
+
+            if (router_type == "floyd_warshall"s) {
+                result.router_type = RouterType::FLOYD_WARSHALL;
+            }
+            else if (router_type == "dijkstra"s) {
+                result.router_type = RouterType::DIJKSTRA;
+            }
+            else if (router_type == "contraction_hierarchies"s) {
+                result.router_type = RouterType::CONTRACTION_HIERARCHIES;
+            }
+            else if (router_type == "blocked_floyd_warshall"s) {
+                result.router_type = RouterType::BLOCKED_FLOYD_WARSHALL;
+            }
+            else if (router_type == "astar"s) {
+                result.router_type = RouterType::A_STAR;
+            }
+            else if (router_type == "hub_labels"s) {
+                result.router_type = RouterType::HUB_LABELS;
+            }
+            else {
+                throw std::invalid_argument("Unknown router type"s);
+            }
+        }
+
+        if (routing_settings.count("graph_model"s)) {
+            const std::string& graph_model = routing_settings.at("graph_model"s).AsString();
+
+            if (graph_model == "dense"s) {
+                result.graph_model = GraphModel::DENSE;
+            }
+            else if (graph_model == "linear"s) {
+                result.graph_model = GraphModel::LINEAR;
+            }
+            else {
+                throw std::invalid_argument("Unknown graph model"s);
+            }
+        }
+
+        if (routing_settings.count("router_threads"s)) {
+            result.thread_count = static_cast<size_t>(routing_settings.at("router_threads"s).AsInt());
+        }
+
+        if (routing_settings.count("route_cache_capacity"s)) {
+            result.route_cache_capacity = static_cast<size_t>(routing_settings.at("route_cache_capacity"s).AsInt());
+        }
+
+        if (routing_settings.count("walking_velocity"s)) {
+            result.walking_velocity = routing_settings.at("walking_velocity"s).AsDouble();
+            if (result.walking_velocity <= 0.) {
+                throw std::invalid_argument("Walking velocity should be positive"s);
+            }
+        }
+
+        if (routing_settings.count("walking_stop_count"s)) {
+            result.walking_stop_count = static_cast<size_t>(routing_settings.at("walking_stop_count"s).AsInt());
+        }
+
+        if (routing_settings.count("walking_transfer_radius"s)) {
+            result.walking_transfer_radius = routing_settings.at("walking_transfer_radius"s).AsDouble();
+        }
+
+        return result;
+    }
+
 
 
 
@@ -216,8 +393,8 @@ namespace transport_catalogue {
             if (request.at("type"s) == "Stop"s) {
                 if (std::optional<StopsBuses> stop_info = catalogue_->GetBusesByStop(request.at("name"s).AsString())) {
                     json::Array buses;
-                    for (std::string_view bus : *stop_info) {
-                        buses.push_back(std::string(bus));
+                    for (BusId bus_id : *stop_info) {
+                        buses.push_back(std::string(catalogue_->GetBuses()[bus_id].name));
                     }
                     response["buses"s] = buses;
                 }
@@ -248,6 +425,56 @@ namespace transport_catalogue {
             else if (request.at("type"s) == "Route"s) {
                 response = router_.BuildRoute(request).AsDict();
             }
+            else if (request.at("type"s) == "Reachable"s) {
+                const auto reachable_stops = router_.FindReachableStops(request.at("stop_name"s).AsString(), request.at("minutes"s).AsDouble());
+
+                json::Array stops;
+                std::vector<std::string_view> stop_names;
+                for (const auto& [stop_name, time] : reachable_stops) {
+                    stops.push_back(json::Dict{ {"stop_name"s, std::string(stop_name)}, {"time"s, time} });
+                    stop_names.push_back(stop_name);
+                }
+                response["stops"s] = std::move(stops);
+
+                if (request.count("with_map"s) && request.at("with_map"s).AsBool()) {
+                    std::ostringstream map_output;
+
+                    renderer_.Render(map_output, stop_names);
+
+                    response["map"s] = map_output.str();
+                }
+            }
+            else if (request.at("type"s) == "RouteMatrix"s) {
+                response = router_.BuildRouteMatrix(request).AsDict();
+            }
+            else if (request.at("type"s) == "NearestStops"s) {
+                std::optional<size_t> count;
+                if (request.count("count"s)) {
+                    count = static_cast<size_t>(request.at("count"s).AsInt());
+                }
+                std::optional<double> radius;
+                if (request.count("radius"s)) {
+                    radius = request.at("radius"s).AsDouble();
+                }
+
+                const geo::Coordinates point{ request.at("latitude"s).AsDouble(), request.at("longitude"s).AsDouble() };
+
+                json::Array stops;
+                for (const auto& [stop, distance] : catalogue_->FindNearestStops(point, count, radius)) {
+                    stops.push_back(json::Dict{ {"stop_name"s, std::string(stop->name)}, {"distance"s, distance} });
+                }
+                response["stops"s] = std::move(stops);
+            }
+            else if (request.at("type"s) == "StopSearch"s) {
+                const size_t max_distance = request.count("max_distance"s) ? static_cast<size_t>(request.at("max_distance"s).AsInt()) : 1;
+                const size_t limit = request.count("limit"s) ? static_cast<size_t>(request.at("limit"s).AsInt()) : 10;
+
+                json::Array stops;
+                for (const auto& [stop, distance] : catalogue_->SearchStops(request.at("query"s).AsString(), max_distance, limit)) {
+                    stops.push_back(json::Dict{ {"stop_name"s, std::string(stop->name)}, {"distance"s, static_cast<int>(distance)} });
+                }
+                response["stops"s] = std::move(stops);
+            }
             else {
                 throw std::invalid_argument("Unknown request type");
             }
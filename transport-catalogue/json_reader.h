@@ -21,16 +21,21 @@ namespace transport_catalogue {
         enum class ReaderMode {
             DEFAULT,
             SERIALIZATION,
-            DESERIALIZATION
+            DESERIALIZATION,
+            UPDATE
         };
 
     public:
+        struct UpdateMode {};
+
         // * Default Mode
         explicit JSONReader(std::istream& input, std::ostream& output, Catalogue& catalogue);
         // * Serialization Mode
         explicit JSONReader(std::istream& input);
         // * Deserialization Mode
         explicit JSONReader(std::istream& input, std::ostream& output);
+        // * Update Mode: applies update_requests to the serialized base and serializes it back
+        explicit JSONReader(std::istream& input, UpdateMode);
 
         void PrintResponse();
 
@@ -41,6 +46,7 @@ namespace transport_catalogue {
         std::ostream* output_ = nullptr;
         Catalogue* catalogue_ = nullptr;;
         std::optional<graph::DirectedWeightedGraph<TransportRouter::RouteWeight>> graph_ = std::nullopt;
+        RoutingSettings routing_settings_;
         TransportRouter router_;
         renderer::MapRenderer renderer_;
 
@@ -57,6 +63,8 @@ namespace transport_catalogue {
         };
 
         Catalogue& FillCatalogue();
+        void UpdateCatalogue(const json::Array& update_requests);
+        RoutingSettings ParseRoutingSettings() const;
         renderer::MapRenderer& FillRenderer();
         void SetRenderSettings(const json::Dict& render_settings);
         void ParseStatRequests(const json::Array& stat_requests);
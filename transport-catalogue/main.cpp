@@ -9,7 +9,7 @@
 using namespace std::literals;
 
 void PrintUsage(std::ostream& stream = std::cerr) {
-    stream << "Usage: transport_catalogue [make_base|process_requests]\n"sv;
+    stream << "Usage: transport_catalogue [make_base|process_requests|update_base]\n"sv;
 }
 
 int main(int argc, char* argv[]) {
@@ -28,6 +28,9 @@ int main(int argc, char* argv[]) {
         transport_catalogue::JSONReader reader(std::cin, std::cout);
         reader.PrintResponse();
     }
+    else if (mode == "update_base"sv) {
+        transport_catalogue::JSONReader reader(std::cin, transport_catalogue::JSONReader::UpdateMode{});
+    }
     else {
         PrintUsage();
         return 1;
@@ -35,6 +35,10 @@ namespace transport_catalogue::renderer {
 	}
 
 	void MapRenderer::Render(std::ostream& out) const {
+		Render(out, {});
+	}
+
+	void MapRenderer::Render(std::ostream& out, const std::vector<std::string_view>& highlighted_stops) const {
 		using namespace std::literals;
 
 		SphereProjector proj(coordinates_.begin(), coordinates_.end(), width_, height_, padding_);
@@ -49,6 +53,8 @@ namespace transport_catalogue::renderer {
 		RenderStopCircles(doc, proj);
 		// 4. названия остановок
 		RenderStopNames(doc, proj);
+		// 5. выделенные остановки
+		RenderHighlightedStops(doc, proj, highlighted_stops);
 
 
 		doc.Render(out);
@@ -126,6 +132,34 @@ namespace transport_catalogue::renderer {
 
 
 
+	void MapRenderer::RenderHighlightedStops(svg::Document& doc, const SphereProjector& proj, const std::vector<std::string_view>& stops) const {
+		using namespace std::literals;
+
+		if (stops.empty() || color_palette_.empty()) {
+			return;
+		}
+
+		for (std::string_view stop : stops) {
+			const auto stop_it = stops_.find(stop);
+			if (stop_it == stops_.end()) {
+				continue;
+			}
+
+			svg::Circle stop_circle;
+
+			stop_circle
+				.SetCenter(proj(stop_it->second))
+				.SetRadius(stop_radius_ * 2.)
+				.SetFillColor("none"s)
+				.SetStrokeColor(color_palette_.front())
+				.SetStrokeWidth(line_width_);
+
+			doc.Add(stop_circle);
+		}
+	}
+
+
+
 	void MapRenderer::RenderStopCircles(svg::Document& doc, const SphereProjector& proj) const {
 		using namespace std::literals;
 
@@ -54,6 +54,8 @@ namespace transport_catalogue::renderer {
 
 
         void Render(std::ostream& out) const;
+        // the map with the highlighted stops ringed over it
+        void Render(std::ostream& out, const std::vector<std::string_view>& highlighted_stops) const;
 
         MapRenderer& AddBus(const Bus& bus);
 
@@ -127,6 +129,7 @@ namespace transport_catalogue::renderer {
         void RenderRouteNames(svg::Document& doc, const SphereProjector& proj) const;
         void RenderStopCircles(svg::Document& doc, const SphereProjector& proj) const;
         void RenderStopNames(svg::Document& doc, const SphereProjector& proj) const;
+        void RenderHighlightedStops(svg::Document& doc, const SphereProjector& proj, const std::vector<std::string_view>& stops) const;
 
 
 
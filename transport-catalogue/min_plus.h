@@ -0,0 +1,116 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define GRAPH_MIN_PLUS_X86
+#include <immintrin.h>
+#endif
+
+namespace graph::min_plus {
+
+// One min-plus row update of the routes matrix for the columns [begin, end):
+//   if weight_from + row_through[to] < row[to], row[to] takes the sum and
+//   row_prev_edges[to] the last edge of the route: row_through_prev_edges[to],
+//   or prev_edge_from when that one is no_edge.
+// RelaxRow picks the widest kernel the CPU supports once, on the first call.
+struct RowUpdate {
+    double* row;
+    uint32_t* row_prev_edges;
+    const double* row_through;
+    const uint32_t* row_through_prev_edges;
+    double weight_from;
+    uint32_t prev_edge_from;
+    uint32_t no_edge;
+};
+
+inline void RelaxRowScalar(const RowUpdate& update, size_t begin, size_t end) {
+    for (size_t to = begin; to < end; ++to) {
+        const double candidate_weight = update.weight_from + update.row_through[to];
+        if (candidate_weight < update.row[to]) {
+            update.row[to] = candidate_weight;
+            update.row_prev_edges[to] = update.row_through_prev_edges[to] != update.no_edge
+                ? update.row_through_prev_edges[to]
+                : update.prev_edge_from;
+        }
+    }
+}
+
+#ifdef GRAPH_MIN_PLUS_X86
+
+__attribute__((target("avx2")))
+inline void RelaxRowAvx2(const RowUpdate& update, size_t begin, size_t end) {
+    const __m256d weight_from = _mm256_set1_pd(update.weight_from);
+    const __m128i prev_edge_from = _mm_set1_epi32(static_cast<int>(update.prev_edge_from));
+    const __m128i no_edge = _mm_set1_epi32(static_cast<int>(update.no_edge));
+    // * picks the low halves of the 64-bit compare lanes to mask the 32-bit edge ids
+    const __m256i low_halves = _mm256_setr_epi32(0, 2, 4, 6, 0, 2, 4, 6);
+
+    size_t to = begin;
+    for (; to + 4 <= end; to += 4) {
+        const __m256d candidate = _mm256_add_pd(weight_from, _mm256_loadu_pd(update.row_through + to));
+        const __m256d current = _mm256_loadu_pd(update.row + to);
+        const __m256d improved = _mm256_cmp_pd(candidate, current, _CMP_LT_OQ);
+        if (_mm256_movemask_pd(improved) == 0) {
+            continue;
+        }
+        _mm256_storeu_pd(update.row + to, _mm256_blendv_pd(current, candidate, improved));
+
+        const __m128i through_prev = _mm_loadu_si128(reinterpret_cast<const __m128i*>(update.row_through_prev_edges + to));
+        const __m128i new_prev = _mm_blendv_epi8(through_prev, prev_edge_from, _mm_cmpeq_epi32(through_prev, no_edge));
+        const __m128i mask = _mm256_castsi256_si128(_mm256_permutevar8x32_epi32(_mm256_castpd_si256(improved), low_halves));
+        __m128i* const prev = reinterpret_cast<__m128i*>(update.row_prev_edges + to);
+        _mm_storeu_si128(prev, _mm_blendv_epi8(_mm_loadu_si128(prev), new_prev, mask));
+    }
+
+    RelaxRowScalar(update, to, end);
+}
+
+__attribute__((target("avx512f,avx512vl")))
+inline void RelaxRowAvx512(const RowUpdate& update, size_t begin, size_t end) {
+    const __m512d weight_from = _mm512_set1_pd(update.weight_from);
+    const __m256i prev_edge_from = _mm256_set1_epi32(static_cast<int>(update.prev_edge_from));
+    const __m256i no_edge = _mm256_set1_epi32(static_cast<int>(update.no_edge));
+
+    size_t to = begin;
+    for (; to + 8 <= end; to += 8) {
+        const __m512d candidate = _mm512_add_pd(weight_from, _mm512_loadu_pd(update.row_through + to));
+        const __mmask8 improved = _mm512_cmp_pd_mask(candidate, _mm512_loadu_pd(update.row + to), _CMP_LT_OQ);
+        if (improved == 0) {
+            continue;
+        }
+        _mm512_mask_storeu_pd(update.row + to, improved, candidate);
+
+        const __m256i through_prev = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(update.row_through_prev_edges + to));
+        const __mmask8 through_is_empty = _mm256_cmpeq_epi32_mask(through_prev, no_edge);
+        const __m256i new_prev = _mm256_mask_blend_epi32(through_is_empty, through_prev, prev_edge_from);
+        _mm256_mask_storeu_epi32(update.row_prev_edges + to, improved, new_prev);
+    }
+
+    RelaxRowScalar(update, to, end);
+}
+
+#endif
+
+using RelaxRowKernel = void (*)(const RowUpdate& update, size_t begin, size_t end);
+
+inline RelaxRowKernel SelectRelaxRowKernel() {
+#ifdef GRAPH_MIN_PLUS_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512vl")) {
+        return RelaxRowAvx512;
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        return RelaxRowAvx2;
+    }
+#endif
+    return RelaxRowScalar;
+}
+
+inline void RelaxRow(const RowUpdate& update, size_t begin, size_t end) {
+    static const RelaxRowKernel kernel = SelectRelaxRowKernel();
+    kernel(update, begin, end);
+}
+
+}  // namespace graph::min_plus
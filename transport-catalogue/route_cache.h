@@ -0,0 +1,87 @@
+#pragma once
+
+#include "json.h"
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <utility>
+
+namespace transport_catalogue {
+
+	// bounded LRU cache of built Route responses keyed by the ids of the stops;
+	// the cache itself is safe to use from several threads: the order of use is guarded by a mutex, the counters are atomic.
+	// It does not make the searches on a miss safe, TransportRouter serializes them on its own lock
+	class RouteCache {
+	public:
+		using Key = std::pair<size_t, size_t>;
+
+		struct Stats {
+			size_t hits = 0;
+			size_t misses = 0;
+			size_t size = 0;
+			size_t capacity = 0;
+		};
+
+		explicit RouteCache(size_t capacity)
+			: capacity_(capacity) {
+		}
+
+		// a copy of the response: the caller adds its request_id to it
+		std::optional<json::Node> Find(const Key& key) {
+			std::lock_guard lock(mutex_);
+
+			auto it = index_.find(key);
+			if (it == index_.end()) {
+				++misses_;
+				return std::nullopt;
+			}
+
+			// * the used entry goes to the front, the back is evicted first
+			entries_.splice(entries_.begin(), entries_, it->second);
+			++hits_;
+			return it->second->second;
+		}
+
+		void Put(const Key& key, json::Node response) {
+			std::lock_guard lock(mutex_);
+
+			if (capacity_ == 0 || index_.count(key)) {
+				return;
+			}
+			if (entries_.size() == capacity_) {
+				index_.erase(entries_.back().first);
+				entries_.pop_back();
+			}
+
+			entries_.emplace_front(key, std::move(response));
+			index_[key] = entries_.begin();
+		}
+
+		Stats GetStats() const {
+			std::lock_guard lock(mutex_);
+			return { hits_.load(), misses_.load(), entries_.size(), capacity_ };
+		}
+
+	private:
+		struct KeyHasher {
+			size_t operator()(const Key& key) const {
+				return std::hash<size_t>{}(key.first) * 37 + std::hash<size_t>{}(key.second);
+			}
+		};
+
+		const size_t capacity_;
+
+		mutable std::mutex mutex_;
+		std::list<std::pair<Key, json::Node>> entries_;
+		std::unordered_map<Key, std::list<std::pair<Key, json::Node>>::iterator, KeyHasher> index_;
+
+		std::atomic<size_t> hits_ = 0;
+		std::atomic<size_t> misses_ = 0;
+	};
+
+}
@@ -1,34 +1,57 @@
 #pragma once
 
 #include "graph.h"
+#include "min_plus.h"
 
 #include <algorithm>
 #include <cassert>
+#include <chrono>
+#include <condition_variable>
 #include <cstdint>
+#include <functional>
 #include <iterator>
+#include <limits>
+#include <mutex>
 #include <optional>
 #include <stdexcept>
+#include <thread>
 #include <unordered_map>
 #include <utility>
 #include <vector>
 
 namespace graph {
 
+// Weight has to be explicitly convertible to double: the matrix keeps only
+// that value, everything else is taken from the edges of the built route.
 template <typename Weight>
 class Router {
 private:
     using Graph = DirectedWeightedGraph<Weight>;
 
 public:
-    struct RouteInternalData {
-        Weight weight;
-        std::optional<EdgeId> prev_edge;
+    // Row-major vertex_count x vertex_count matrix. A missing route has an
+    // infinite weight, a route without edges has NO_EDGE as its prev_edge.
+    struct RoutesInternalData {
+        size_t vertex_count = 0;
+        std::vector<double> weights;
+        std::vector<uint32_t> prev_edges;
     };
-    using RoutesInternalData = std::vector<std::vector<std::optional<RouteInternalData>>>;
+
+    static constexpr double NO_ROUTE = std::numeric_limits<double>::infinity();
+    static constexpr uint32_t NO_EDGE = std::numeric_limits<uint32_t>::max();
 
 
     explicit Router(const Graph& graph);
+    // Tiled Floyd-Warshall: the matrix is split into square blocks and every
+    // round relaxes the blocks that do not depend on each other in parallel
+    explicit Router(const Graph& graph, size_t thread_count);
     explicit Router(const Graph& graph, RoutesInternalData&& routes_internal_data);
+    // Repairs the matrix of the previous graph for the changed one. new_edge_ids
+    // maps every edge of the previous graph to its id in the graph, or to NO_EDGE
+    // if it was removed; the graph may only add vertices at the end. A row is
+    // searched again only if its route tree lost an edge or an added edge makes
+    // one of its routes shorter, the rest of the rows are copied
+    explicit Router(const Graph& graph, Router&& previous, const std::vector<uint32_t>& new_edge_ids);
 
     struct RouteInfo {
         Weight weight;
@@ -38,44 +61,186 @@ public:
     std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const;
 
     const RoutesInternalData& GetRoutesInternalData() const;
+    std::chrono::milliseconds GetBuildDuration() const;
+    // rows searched again by the repairing constructor
+    size_t GetRepairedRowCount() const;
 
 private:
+    // With the compact matrix a 64x64 tile is 32 KiB of weights plus 16 KiB of
+    // previous edges, so the three tiles of a relaxation still fit in L2, and
+    // the rounds are half as many as with 32x32 tiles.
+    static constexpr size_t BLOCK_SIZE = 64;
+
+    class Barrier {
+    public:
+        explicit Barrier(size_t thread_count)
+            : thread_count_(thread_count) {
+        }
+
+        void Wait() {
+            std::unique_lock lock(mutex_);
+            const size_t generation = generation_;
+            if (++waiting_count_ == thread_count_) {
+                waiting_count_ = 0;
+                ++generation_;
+                condition_.notify_all();
+                return;
+            }
+            condition_.wait(lock, [this, generation] { return generation != generation_; });
+        }
+
+    private:
+        std::mutex mutex_;
+        std::condition_variable condition_;
+        const size_t thread_count_;
+        size_t waiting_count_ = 0;
+        size_t generation_ = 0;
+    };
 
     void InitializeRoutesInternalData(const Graph& graph) {
         const size_t vertex_count = graph.GetVertexCount();
+        if (!graph.IsFinalized()) {
+            throw std::invalid_argument("The graph should be finalized");
+        }
+        if (graph.GetEdgeCount() >= NO_EDGE) {
+            throw std::length_error("Too many edges for 32-bit edge ids");
+        }
+
+        routes_internal_data_.vertex_count = vertex_count;
+        routes_internal_data_.weights.assign(vertex_count * vertex_count, NO_ROUTE);
+        routes_internal_data_.prev_edges.assign(vertex_count * vertex_count, NO_EDGE);
+
         for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
-            routes_internal_data_[vertex][vertex] = RouteInternalData{ZERO_WEIGHT, std::nullopt};
+            routes_internal_data_.weights[vertex * vertex_count + vertex] = 0.;
             for (const EdgeId edge_id : graph.GetIncidentEdges(vertex)) {
                 const auto& edge = graph.GetEdge(edge_id);
                 if (edge.weight < ZERO_WEIGHT) {
                     throw std::domain_error("Edges' weights should be non-negative");
                 }
-                auto& route_internal_data = routes_internal_data_[vertex][edge.to];
-                if (!route_internal_data || route_internal_data->weight > edge.weight) {
-                    route_internal_data = RouteInternalData{edge.weight, edge_id};
+                const size_t cell = vertex * vertex_count + edge.to;
+                const double weight = static_cast<double>(edge.weight);
+                if (weight < routes_internal_data_.weights[cell]) {
+                    routes_internal_data_.weights[cell] = weight;
+                    routes_internal_data_.prev_edges[cell] = static_cast<uint32_t>(edge_id);
                 }
             }
         }
     }
 
-    void RelaxRoute(VertexId vertex_from, VertexId vertex_to, const RouteInternalData& route_from,
-                    const RouteInternalData& route_to) {
-        auto& route_relaxing = routes_internal_data_[vertex_from][vertex_to];
-        const Weight candidate_weight = route_from.weight + route_to.weight;
-        if (!route_relaxing || candidate_weight < route_relaxing->weight) {
-            route_relaxing = {candidate_weight,
-                              route_to.prev_edge ? route_to.prev_edge : route_from.prev_edge};
+    // Relaxes row vertex_from through vertex_through for the columns [to_begin, to_end)
+    void RelaxRowThroughVertex(VertexId vertex_from, VertexId vertex_through, VertexId to_begin, VertexId to_end) {
+        const size_t vertex_count = routes_internal_data_.vertex_count;
+        const double weight_from = routes_internal_data_.weights[vertex_from * vertex_count + vertex_through];
+        if (weight_from == NO_ROUTE) {
+            return;
         }
+
+        // * vectorized with runtime CPU dispatch, see min_plus.h
+        min_plus::RelaxRow({
+            routes_internal_data_.weights.data() + vertex_from * vertex_count,
+            routes_internal_data_.prev_edges.data() + vertex_from * vertex_count,
+            routes_internal_data_.weights.data() + vertex_through * vertex_count,
+            routes_internal_data_.prev_edges.data() + vertex_through * vertex_count,
+            weight_from,
+            routes_internal_data_.prev_edges[vertex_from * vertex_count + vertex_through],
+            NO_EDGE }, to_begin, to_end);
     }
 
     void RelaxRoutesInternalDataThroughVertex(size_t vertex_count, VertexId vertex_through) {
         for (VertexId vertex_from = 0; vertex_from < vertex_count; ++vertex_from) {
-            if (const auto& route_from = routes_internal_data_[vertex_from][vertex_through]) {
-                for (VertexId vertex_to = 0; vertex_to < vertex_count; ++vertex_to) {
-                    if (const auto& route_to = routes_internal_data_[vertex_through][vertex_to]) {
-                        RelaxRoute(vertex_from, vertex_to, *route_from, *route_to);
+            RelaxRowThroughVertex(vertex_from, vertex_through, 0, vertex_count);
+        }
+    }
+
+    void RelaxBlockThroughBlock(size_t block_through, size_t block_from, size_t block_to) {
+        const size_t vertex_count = routes_internal_data_.vertex_count;
+        const VertexId through_end = std::min(vertex_count, (block_through + 1) * BLOCK_SIZE);
+        const VertexId from_end = std::min(vertex_count, (block_from + 1) * BLOCK_SIZE);
+        const VertexId to_end = std::min(vertex_count, (block_to + 1) * BLOCK_SIZE);
+
+        for (VertexId vertex_through = block_through * BLOCK_SIZE; vertex_through < through_end; ++vertex_through) {
+            for (VertexId vertex_from = block_from * BLOCK_SIZE; vertex_from < from_end; ++vertex_from) {
+                RelaxRowThroughVertex(vertex_from, vertex_through, block_to * BLOCK_SIZE, to_end);
+            }
+        }
+    }
+
+    void RelaxBlocksInParallel(size_t thread_count) {
+        const size_t block_count = (routes_internal_data_.vertex_count + BLOCK_SIZE - 1) / BLOCK_SIZE;
+        Barrier barrier(thread_count);
+
+        auto worker = [this, block_count, thread_count, &barrier](size_t thread_index) {
+            for (size_t block_through = 0; block_through < block_count; ++block_through) {
+                // 1. the block on the diagonal depends only on itself
+                if (thread_index == 0) {
+                    RelaxBlockThroughBlock(block_through, block_through, block_through);
+                }
+                barrier.Wait();
+
+                // 2. blocks of the same row and column depend only on the diagonal block
+                for (size_t block = thread_index; block < block_count; block += thread_count) {
+                    if (block != block_through) {
+                        RelaxBlockThroughBlock(block_through, block_through, block);
+                        RelaxBlockThroughBlock(block_through, block, block_through);
                     }
                 }
+                barrier.Wait();
+
+                // 3. the rest of the blocks depend on the row and the column
+                for (size_t block_from = thread_index; block_from < block_count; block_from += thread_count) {
+                    if (block_from == block_through) {
+                        continue;
+                    }
+                    for (size_t block_to = 0; block_to < block_count; ++block_to) {
+                        if (block_to != block_through) {
+                            RelaxBlockThroughBlock(block_through, block_from, block_to);
+                        }
+                    }
+                }
+                barrier.Wait();
+            }
+        };
+
+        std::vector<std::thread> threads;
+        threads.reserve(thread_count - 1);
+        for (size_t thread_index = 1; thread_index < thread_count; ++thread_index) {
+            threads.emplace_back(worker, thread_index);
+        }
+        worker(0);
+
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+    }
+
+    // Dijkstra search from the vertex that overwrites its row
+    void SearchRow(VertexId vertex_from) {
+        const size_t vertex_count = routes_internal_data_.vertex_count;
+        double* const row = routes_internal_data_.weights.data() + vertex_from * vertex_count;
+        uint32_t* const row_prev_edges = routes_internal_data_.prev_edges.data() + vertex_from * vertex_count;
+
+        std::fill(row, row + vertex_count, NO_ROUTE);
+        std::fill(row_prev_edges, row_prev_edges + vertex_count, NO_EDGE);
+        row[vertex_from] = 0.;
+
+        std::vector<std::pair<double, VertexId>> queue{ { 0., vertex_from } };
+        while (!queue.empty()) {
+            std::pop_heap(queue.begin(), queue.end(), std::greater<>{});
+            const auto [weight, vertex] = queue.back();
+            queue.pop_back();
+
+            if (weight > row[vertex]) {
+                continue;
+            }
+            for (const EdgeId edge_id : graph_.GetIncidentEdges(vertex)) {
+                const auto& edge = graph_.GetEdge(edge_id);
+                const double candidate_weight = weight + static_cast<double>(edge.weight);
+                if (candidate_weight < row[edge.to]) {
+                    row[edge.to] = candidate_weight;
+                    row_prev_edges[edge.to] = static_cast<uint32_t>(edge_id);
+                    queue.emplace_back(candidate_weight, edge.to);
+                    std::push_heap(queue.begin(), queue.end(), std::greater<>{});
+                }
             }
         }
     }
@@ -83,6 +248,8 @@ private:
     static constexpr Weight ZERO_WEIGHT{};
     const Graph& graph_;
     RoutesInternalData routes_internal_data_;
+    std::chrono::milliseconds build_duration_{ 0 };
+    size_t repaired_row_count_ = 0;
 };
 
 
@@ -92,41 +259,160 @@ private:
 template <typename Weight>
 Router<Weight>::Router(const Graph& graph)
     : graph_(graph)
-    , routes_internal_data_(graph.GetVertexCount(),
-                            std::vector<std::optional<RouteInternalData>>(graph.GetVertexCount()))
 {
+    const auto start = std::chrono::steady_clock::now();
+
     InitializeRoutesInternalData(graph);
 
     const size_t vertex_count = graph.GetVertexCount();
     for (VertexId vertex_through = 0; vertex_through < vertex_count; ++vertex_through) {
         RelaxRoutesInternalDataThroughVertex(vertex_count, vertex_through);
     }
+
+    build_duration_ = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+}
+
+template <typename Weight>
+Router<Weight>::Router(const Graph& graph, size_t thread_count)
+    : graph_(graph)
+{
+    const auto start = std::chrono::steady_clock::now();
+
+    InitializeRoutesInternalData(graph);
+    RelaxBlocksInParallel(std::max<size_t>(thread_count, 1));
+
+    build_duration_ = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
 }
 
 template <typename Weight>
 Router<Weight>::Router(const Graph& graph, RoutesInternalData&& routes_internal_data)
     : graph_(graph),
-    routes_internal_data_(std::move(routes_internal_data)) { }
+    routes_internal_data_(std::move(routes_internal_data))
+{
+    const size_t cell_count = routes_internal_data_.vertex_count * routes_internal_data_.vertex_count;
+    if (routes_internal_data_.vertex_count != graph.GetVertexCount()
+        || routes_internal_data_.weights.size() != cell_count
+        || routes_internal_data_.prev_edges.size() != cell_count) {
+        throw std::invalid_argument("Routes internal data does not match the graph");
+    }
+}
+
+
+
+template <typename Weight>
+Router<Weight>::Router(const Graph& graph, Router&& previous, const std::vector<uint32_t>& new_edge_ids)
+    : graph_(graph)
+{
+    const auto start = std::chrono::steady_clock::now();
+
+    const size_t vertex_count = graph.GetVertexCount();
+    const size_t edge_count = graph.GetEdgeCount();
+    const size_t previous_vertex_count = previous.routes_internal_data_.vertex_count;
+    if (!graph.IsFinalized()) {
+        throw std::invalid_argument("The graph should be finalized");
+    }
+    if (edge_count >= NO_EDGE) {
+        throw std::length_error("Too many edges for 32-bit edge ids");
+    }
+    if (vertex_count < previous_vertex_count || new_edge_ids.size() != previous.graph_.GetEdgeCount()) {
+        throw std::invalid_argument("Edge ids do not match the previous graph");
+    }
+
+    std::vector<bool> is_added_edge(edge_count, true);
+    for (const uint32_t edge_id : new_edge_ids) {
+        if (edge_id == NO_EDGE) {
+            continue;
+        }
+        if (edge_id >= edge_count) {
+            throw std::out_of_range("Edge id is out of range");
+        }
+        is_added_edge[edge_id] = false;
+    }
+
+    routes_internal_data_.vertex_count = vertex_count;
+    routes_internal_data_.weights.assign(vertex_count * vertex_count, NO_ROUTE);
+    routes_internal_data_.prev_edges.assign(vertex_count * vertex_count, NO_EDGE);
+
+    // * a kept edge has the same weight, so a row whose route tree lost no edge is still a valid tree
+    std::vector<bool> is_stale_row(vertex_count, true);
+    for (VertexId vertex_from = 0; vertex_from < previous_vertex_count; ++vertex_from) {
+        const double* const previous_row = previous.routes_internal_data_.weights.data() + vertex_from * previous_vertex_count;
+        const uint32_t* const previous_row_prev_edges = previous.routes_internal_data_.prev_edges.data() + vertex_from * previous_vertex_count;
+        double* const row = routes_internal_data_.weights.data() + vertex_from * vertex_count;
+        uint32_t* const row_prev_edges = routes_internal_data_.prev_edges.data() + vertex_from * vertex_count;
+
+        bool is_stale = false;
+        for (VertexId to = 0; to < previous_vertex_count; ++to) {
+            row[to] = previous_row[to];
+            if (previous_row_prev_edges[to] != NO_EDGE) {
+                row_prev_edges[to] = new_edge_ids[previous_row_prev_edges[to]];
+                is_stale = is_stale || row_prev_edges[to] == NO_EDGE;
+            }
+        }
+        is_stale_row[vertex_from] = is_stale;
+    }
+    previous.routes_internal_data_ = {};
+
+    // * an added edge matters to the row only if it shortens a route of it
+    for (EdgeId edge_id = 0; edge_id < edge_count; ++edge_id) {
+        if (!is_added_edge[edge_id]) {
+            continue;
+        }
+        const auto& edge = graph.GetEdge(edge_id);
+        if (edge.weight < ZERO_WEIGHT) {
+            throw std::domain_error("Edges' weights should be non-negative");
+        }
+        const double weight = static_cast<double>(edge.weight);
+        for (VertexId vertex_from = 0; vertex_from < previous_vertex_count; ++vertex_from) {
+            const double* const row = routes_internal_data_.weights.data() + vertex_from * vertex_count;
+            if (!is_stale_row[vertex_from] && row[edge.from] + weight < row[edge.to]) {
+                is_stale_row[vertex_from] = true;
+            }
+        }
+    }
+
+    for (VertexId vertex_from = 0; vertex_from < vertex_count; ++vertex_from) {
+        if (is_stale_row[vertex_from]) {
+            SearchRow(vertex_from);
+            ++repaired_row_count_;
+        }
+    }
+
+    build_duration_ = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+}
 
 
 
 template <typename Weight>
 std::optional<typename Router<Weight>::RouteInfo> Router<Weight>::BuildRoute(VertexId from,
                                                                              VertexId to) const {
-    const auto& route_internal_data = routes_internal_data_.at(from).at(to);
-    if (!route_internal_data) {
+    const size_t vertex_count = routes_internal_data_.vertex_count;
+    if (from >= vertex_count || to >= vertex_count) {
+        throw std::out_of_range("Vertex id is out of range");
+    }
+
+    const double* const row_weights = routes_internal_data_.weights.data() + from * vertex_count;
+    const uint32_t* const row_prev_edges = routes_internal_data_.prev_edges.data() + from * vertex_count;
+
+    if (row_weights[to] == NO_ROUTE) {
         return std::nullopt;
     }
-    const Weight weight = route_internal_data->weight;
+
     std::vector<EdgeId> edges;
-    for (std::optional<EdgeId> edge_id = route_internal_data->prev_edge;
-         edge_id;
-         edge_id = routes_internal_data_[from][graph_.GetEdge(*edge_id).from]->prev_edge)
+    for (uint32_t edge_id = row_prev_edges[to];
+         edge_id != NO_EDGE;
+         edge_id = row_prev_edges[graph_.GetEdge(edge_id).from])
     {
-        edges.push_back(*edge_id);
+        edges.push_back(edge_id);
     }
     std::reverse(edges.begin(), edges.end());
 
+    // * the matrix keeps only the total, the full weight is collected from the edges
+    Weight weight = ZERO_WEIGHT;
+    for (const EdgeId edge_id : edges) {
+        weight = weight + graph_.GetEdge(edge_id).weight;
+    }
+
     return RouteInfo{weight, std::move(edges)};
 }
 
@@ -137,4 +423,14 @@ const typename Router<Weight>::RoutesInternalData& Router<Weight>::GetRoutesInte
     return routes_internal_data_;
 }
 
-}  // namespace graph
\ No newline at end of file
+template <typename Weight>
+std::chrono::milliseconds Router<Weight>::GetBuildDuration() const {
+    return build_duration_;
+}
+
+template <typename Weight>
+size_t Router<Weight>::GetRepairedRowCount() const {
+    return repaired_row_count_;
+}
+
+}  // namespace graph
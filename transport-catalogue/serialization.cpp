@@ -132,31 +132,14 @@ namespace transport_catalogue_serialize {
 		Graph ConvertGraphToRaw(const graph::DirectedWeightedGraph<transport_catalogue::TransportRouter::RouteWeight>& graph) {
 			Graph result;
 
-			for (const std::vector<graph::EdgeId>& ids : graph.GetIncidentLists()) {
-				IncidenceList incidence_list;
-
-				for (graph::EdgeId id : ids) {
-					incidence_list.add_incidence(id);
-				}
-
-				*(result.add_incidence_lists()) = std::move(incidence_list);
-			}
+			result.mutable_offsets()->Add(graph.GetOffsets().begin(), graph.GetOffsets().end());
 
 			for (const graph::Edge<transport_catalogue::TransportRouter::RouteWeight>& edge : graph.GetEdges()) {
 				Edge raw_edge;
 
 				raw_edge.set_from(edge.from);
 				raw_edge.set_to(edge.to);
-
-				Weight raw_weight;
-
-				raw_weight.set_type(static_cast<uint32_t>(edge.weight.type));
-				raw_weight.set_weight(edge.weight.weight);
-				raw_weight.set_name(std::string(edge.weight.name));
-				raw_weight.set_span_count(edge.weight.span_count);
-
-
-				*(raw_edge.mutable_weight()) = std::move(raw_weight);
+				raw_edge.set_weight(edge.weight);
 
 				*(result.add_edges()) = std::move(raw_edge);
 			}
@@ -165,149 +148,195 @@ namespace transport_catalogue_serialize {
 		}
 
 
-		graph::DirectedWeightedGraph<transport_catalogue::TransportRouter::RouteWeight> ConvertRawGraphToNormal(const Graph& raw_graph, const transport_catalogue::Catalogue& catalogue) {
+		graph::DirectedWeightedGraph<transport_catalogue::TransportRouter::RouteWeight> ConvertRawGraphToNormal(const Graph& raw_graph) {
 			std::vector<graph::Edge<transport_catalogue::TransportRouter::RouteWeight>> edges;
 			edges.reserve(raw_graph.edges().size());
 
 
 			for (const Edge& raw_edge : raw_graph.edges()) {
+				edges.push_back({ raw_edge.from(), raw_edge.to(), raw_edge.weight() });
+			}
 
-				std::string_view stop_name;
-				if (transport_catalogue::Stop* stop = catalogue.FindStop(raw_edge.weight().name())) {
-					stop_name = stop->name;
-				}
 
-				graph::Edge<transport_catalogue::TransportRouter::RouteWeight> edge{
-					raw_edge.from(),
-					raw_edge.to(),
-					transport_catalogue::TransportRouter::RouteWeight {
-						static_cast<transport_catalogue::TransportRouter::PassengerActivityType>(raw_edge.weight().type()),
-						raw_edge.weight().weight(),
-						stop_name,
-						raw_edge.weight().span_count()
-					}
-				};
 
-				edges.push_back(std::move(edge));
-			}
+			std::vector<graph::EdgeId> offsets(raw_graph.offsets().begin(), raw_graph.offsets().end());
+
 
+			 return graph::DirectedWeightedGraph<transport_catalogue::TransportRouter::RouteWeight>{std::move(edges), std::move(offsets)};
+		}
 
 
-			std::vector<std::vector<graph::EdgeId>> incidence_lists;
-			incidence_lists.reserve(raw_graph.incidence_lists().size());
+		ContractionHierarchy ConvertContractionHierarchyToRaw(const graph::ContractionHierarchy<transport_catalogue::TransportRouter::RouteWeight>& hierarchy) {
+			ContractionHierarchy result;
 
-			for (const IncidenceList& raw_incidence_list : raw_graph.incidence_lists()) {
-				std::vector<graph::EdgeId> incidence_list(raw_incidence_list.incidence().begin(), raw_incidence_list.incidence().end());
-				incidence_lists.push_back(std::move(incidence_list));
+			for (size_t rank : hierarchy.GetRanks()) {
+				result.add_rank(rank);
 			}
 
+			for (const auto& shortcut : hierarchy.GetShortcuts()) {
+				Shortcut raw_shortcut;
+
+				raw_shortcut.set_from(shortcut.from);
+				raw_shortcut.set_to(shortcut.to);
+				raw_shortcut.set_first(shortcut.first);
+				raw_shortcut.set_second(shortcut.second);
 
-			 return graph::DirectedWeightedGraph<transport_catalogue::TransportRouter::RouteWeight>{std::move(edges), std::move(incidence_lists)};
+				*(result.add_shortcuts()) = std::move(raw_shortcut);
+			}
+
+			return result;
 		}
 
+		graph::ContractionHierarchy<transport_catalogue::TransportRouter::RouteWeight> ConvertRawContractionHierarchyToNormal(
+			const ContractionHierarchy& raw_hierarchy,
+			const graph::DirectedWeightedGraph<transport_catalogue::TransportRouter::RouteWeight>& graph)
+		{
+			using CatalogueHierarchy = graph::ContractionHierarchy<transport_catalogue::TransportRouter::RouteWeight>;
 
-		Router ConvertTransportRouterToRaw(const transport_catalogue::TransportRouter& router) {
-			Router result;
+			std::vector<size_t> ranks(raw_hierarchy.rank().begin(), raw_hierarchy.rank().end());
 
-			*(result.mutable_graph()) = ConvertGraphToRaw(router.GetGraph());
+			std::vector<CatalogueHierarchy::Shortcut> shortcuts;
+			shortcuts.reserve(raw_hierarchy.shortcuts_size());
 
-			using CatalogueRouter = graph::Router<transport_catalogue::TransportRouter::RouteWeight>;
+			for (const Shortcut& raw_shortcut : raw_hierarchy.shortcuts()) {
+				shortcuts.push_back({ raw_shortcut.from(), raw_shortcut.to(), raw_shortcut.first(), raw_shortcut.second() });
+			}
 
-			for (const auto& route_iternal_data_list : router.GetRouter().GetRoutesInternalData()) {
-				RouteInternalDataList route_internal_data_list;
+			return CatalogueHierarchy{ graph, std::move(ranks), std::move(shortcuts) };
+		}
 
-				for (const std::optional<CatalogueRouter::RouteInternalData>& route_internal_data : route_iternal_data_list) {
-					RouteInternalDataOptional route_internal_data_opt;
 
-					if (route_internal_data) {
-						RouteInternalData raw_route_internal_data;
+		HubLabels ConvertHubLabelsToRaw(const graph::HubLabels<transport_catalogue::TransportRouter::RouteWeight>::Labels& labels) {
+			HubLabels result;
 
-						Weight raw_weight;
-						raw_weight.set_type(static_cast<uint32_t>(route_internal_data->weight.type));
-						raw_weight.set_weight(route_internal_data->weight.weight);
-						raw_weight.set_name(std::string(route_internal_data->weight.name));
-						raw_weight.set_span_count(route_internal_data->weight.span_count);
+			result.mutable_offsets()->Add(labels.offsets.begin(), labels.offsets.end());
+			result.mutable_hubs()->Add(labels.hubs.begin(), labels.hubs.end());
+			result.mutable_weights()->Add(labels.weights.begin(), labels.weights.end());
+			result.mutable_edges()->Add(labels.edges.begin(), labels.edges.end());
 
-						*(raw_route_internal_data.mutable_weight()) = std::move(raw_weight);
+			return result;
+		}
 
-						raw_route_internal_data.set_has_prev_edge(route_internal_data->prev_edge.has_value());
-						if (route_internal_data->prev_edge)
-							raw_route_internal_data.set_prev_edge(*(route_internal_data->prev_edge));
 
-						*(route_internal_data_opt.mutable_route_iternal_data()) = std::move(raw_route_internal_data);
-					}
+		graph::HubLabels<transport_catalogue::TransportRouter::RouteWeight>::Labels ConvertRawHubLabelsToNormal(const HubLabels& raw_labels) {
+			return {
+				{ raw_labels.offsets().begin(), raw_labels.offsets().end() },
+				{ raw_labels.hubs().begin(), raw_labels.hubs().end() },
+				{ raw_labels.weights().begin(), raw_labels.weights().end() },
+				{ raw_labels.edges().begin(), raw_labels.edges().end() }
+			};
+		}
 
-					*(route_internal_data_list.add_route_iternal_data_opt()) = std::move(route_internal_data_opt);
-				}
 
-				*(result.add_routes_internal_data()) = std::move(route_internal_data_list);
-			}
+		Router ConvertTransportRouterToRaw(const transport_catalogue::TransportRouter& router) {
+			Router result;
 
-			for (auto [stop_name, size_t] : router.GetStopNamesToIds()) {
-				StopNameToId stop_name_to_id;
+			*(result.mutable_graph()) = ConvertGraphToRaw(router.GetGraph());
 
-				stop_name_to_id.set_stop_name(std::string(stop_name));
-				stop_name_to_id.set_id(size_t);
+			result.set_router_type(static_cast<uint32_t>(router.GetRoutingSettings().router_type));
+			result.set_graph_model(static_cast<uint32_t>(router.GetRoutingSettings().graph_model));
+			result.set_route_cache_capacity(router.GetRoutingSettings().route_cache_capacity);
+			result.set_walking_velocity(router.GetRoutingSettings().walking_velocity);
+			result.set_walking_stop_count(static_cast<uint32_t>(router.GetRoutingSettings().walking_stop_count));
+			result.set_walking_transfer_radius(router.GetRoutingSettings().walking_transfer_radius);
+			result.mutable_vertex_stop_id()->Add(router.GetVertexStopIds().begin(), router.GetVertexStopIds().end());
 
+			for (const transport_catalogue::TransportRouter::EdgeInfo& info : router.GetEdgeInfos()) {
+				EdgeInfo& raw_info = *(result.add_edge_info());
 
-				*(result.add_stop_name_to_id()) = std::move(stop_name_to_id);
+				raw_info.set_type(static_cast<uint32_t>(info.type));
+				raw_info.set_id(info.id);
+				raw_info.set_span_count(info.span_count);
 			}
 
-			return result;
-		}
+			using CatalogueHierarchy = graph::ContractionHierarchy<transport_catalogue::TransportRouter::RouteWeight>;
 
+			if (const CatalogueHierarchy* hierarchy = std::get_if<CatalogueHierarchy>(&router.GetRouter())) {
+				*(result.mutable_contraction_hierarchy()) = ConvertContractionHierarchyToRaw(*hierarchy);
+			}
 
-		transport_catalogue::TransportRouter ConvertRawTransportRouterToNormal(const Router& raw_router, const transport_catalogue::Catalogue& catalogue, graph::DirectedWeightedGraph<transport_catalogue::TransportRouter::RouteWeight>& graph) {
-			graph::Router<transport_catalogue::TransportRouter::RouteWeight>::RoutesInternalData routes_internal_data;
+			using CatalogueHubLabels = graph::HubLabels<transport_catalogue::TransportRouter::RouteWeight>;
 
+			if (const CatalogueHubLabels* labels = std::get_if<CatalogueHubLabels>(&router.GetRouter())) {
+				*(result.mutable_forward_labels()) = ConvertHubLabelsToRaw(labels->GetForwardLabels());
+				*(result.mutable_backward_labels()) = ConvertHubLabelsToRaw(labels->GetBackwardLabels());
+			}
 
+			using CatalogueRouter = graph::Router<transport_catalogue::TransportRouter::RouteWeight>;
 
-			for (const RouteInternalDataList& route_internal_data_list : raw_router.routes_internal_data()) {
-				routes_internal_data.push_back({});
-				for (const RouteInternalDataOptional& route_internal_data_opt : route_internal_data_list.route_iternal_data_opt()) {
-					if (route_internal_data_opt.has_route_iternal_data()) {
-						const auto& route_iternal_data = route_internal_data_opt.route_iternal_data();
+			// * only the Floyd-Warshall engine keeps a precomputed matrix
+			if (const CatalogueRouter* catalogue_router = std::get_if<CatalogueRouter>(&router.GetRouter())) {
+				const CatalogueRouter::RoutesInternalData& routes_internal_data = catalogue_router->GetRoutesInternalData();
+				RoutesInternalData& raw_routes_internal_data = *(result.mutable_routes_internal_data());
 
-						std::string_view stop_name;
+				raw_routes_internal_data.set_vertex_count(routes_internal_data.vertex_count);
+				raw_routes_internal_data.mutable_weights()->Add(routes_internal_data.weights.begin(), routes_internal_data.weights.end());
+				raw_routes_internal_data.mutable_prev_edges()->Add(routes_internal_data.prev_edges.begin(), routes_internal_data.prev_edges.end());
+			}
 
-						if (transport_catalogue::Stop* stop = catalogue.FindStop(route_iternal_data.weight().name())) {
-							stop_name = stop->name;
-						}
+			return result;
+		}
 
-						routes_internal_data.back().push_back(
-							graph::Router<transport_catalogue::TransportRouter::RouteWeight>::RouteInternalData{
-								transport_catalogue::TransportRouter::RouteWeight {
-									transport_catalogue::TransportRouter::PassengerActivityType(route_iternal_data.weight().type()),
-									route_iternal_data.weight().weight(),
-									stop_name,
-									route_iternal_data.weight().span_count()
-								},
 
-								std::nullopt
-							}
-						);
+		transport_catalogue::TransportRouter ConvertRawTransportRouterToNormal(const Router& raw_router, const transport_catalogue::Catalogue& catalogue, graph::DirectedWeightedGraph<transport_catalogue::TransportRouter::RouteWeight>& graph) {
+			const RoutesInternalData& raw_routes_internal_data = raw_router.routes_internal_data();
+
+			graph::Router<transport_catalogue::TransportRouter::RouteWeight>::RoutesInternalData routes_internal_data{
+				raw_routes_internal_data.vertex_count(),
+				{ raw_routes_internal_data.weights().begin(), raw_routes_internal_data.weights().end() },
+				{ raw_routes_internal_data.prev_edges().begin(), raw_routes_internal_data.prev_edges().end() }
+			};
 
 
+			transport_catalogue::RoutingSettings settings;
+			settings.router_type = static_cast<transport_catalogue::RouterType>(raw_router.router_type());
+			settings.graph_model = static_cast<transport_catalogue::GraphModel>(raw_router.graph_model());
+			settings.route_cache_capacity = raw_router.route_cache_capacity();
+			if (raw_router.walking_velocity() > 0.) {
+				settings.walking_velocity = raw_router.walking_velocity();
+			}
+			if (raw_router.walking_stop_count() > 0) {
+				settings.walking_stop_count = raw_router.walking_stop_count();
+			}
+			settings.walking_transfer_radius = raw_router.walking_transfer_radius();
 
-						if (route_iternal_data.has_prev_edge()) {
-							routes_internal_data.back().back()->prev_edge = route_iternal_data.prev_edge();
-						}
+			std::vector<size_t> vertex_stop_ids{ raw_router.vertex_stop_id().begin(), raw_router.vertex_stop_id().end() };
 
-					}
-					else
-						routes_internal_data.back().push_back(std::nullopt);
-				}
+			std::vector<transport_catalogue::TransportRouter::EdgeInfo> edge_infos;
+			edge_infos.reserve(raw_router.edge_info().size());
+			for (const EdgeInfo& raw_info : raw_router.edge_info()) {
+				edge_infos.push_back({
+					static_cast<transport_catalogue::TransportRouter::PassengerActivityType>(raw_info.type()),
+					raw_info.id(),
+					raw_info.span_count() });
 			}
 
+			using Engine = transport_catalogue::TransportRouter::Engine;
 
-			std::unordered_map<std::string_view, size_t> stop_name_to_id;
+			Engine engine = [&]() {
+				switch (settings.router_type) {
+				case (transport_catalogue::RouterType::FLOYD_WARSHALL):
+				case (transport_catalogue::RouterType::BLOCKED_FLOYD_WARSHALL):
+					return Engine{ std::in_place_type<graph::Router<transport_catalogue::TransportRouter::RouteWeight>>,
+						graph, std::move(routes_internal_data) };
 
-			for (const StopNameToId& raw_stop_name_to_id : raw_router.stop_name_to_id()) {
-				stop_name_to_id[std::string_view(catalogue.FindStop(raw_stop_name_to_id.stop_name())->name)] = raw_stop_name_to_id.id();
-			}
+				case (transport_catalogue::RouterType::CONTRACTION_HIERARCHIES):
+					return Engine{ std::in_place_type<graph::ContractionHierarchy<transport_catalogue::TransportRouter::RouteWeight>>,
+						ConvertRawContractionHierarchyToNormal(raw_router.contraction_hierarchy(), graph) };
 
+				case (transport_catalogue::RouterType::HUB_LABELS):
+					return Engine{ std::in_place_type<graph::HubLabels<transport_catalogue::TransportRouter::RouteWeight>>,
+						graph,
+						ConvertRawHubLabelsToNormal(raw_router.forward_labels()),
+						ConvertRawHubLabelsToNormal(raw_router.backward_labels()) };
 
-			return transport_catalogue::TransportRouter{ catalogue, graph, std::move(routes_internal_data), std::move(stop_name_to_id) };
+				default:
+					return transport_catalogue::TransportRouter::BuildEngine(graph, catalogue, settings, vertex_stop_ids);
+				}
+			}();
+
+
+			return transport_catalogue::TransportRouter{ catalogue, graph, settings, std::move(engine), std::move(vertex_stop_ids), std::move(edge_infos) };
 		}
 
 
@@ -318,22 +347,17 @@ namespace transport_catalogue_serialize {
 			TransportCatalogue result;
 
 			result.set_bus_wait_time(catalogue.GetWaitTime());
-			result.set_bus_wait_time(catalogue.GetBusVelocity());
+			result.set_bus_velocity(catalogue.GetBusVelocity());
 
 
-			std::unordered_map<const transport_catalogue::Stop*, uint32_t> stops_to_stop_ids;
-			uint32_t curent_id = 0;
 			for (const transport_catalogue::Stop& stop : catalogue.GetStops()) {
 				Stop raw_stop;
-				raw_stop.set_name(stop.name);
+				raw_stop.set_name(std::string(stop.name));
 
 				raw_stop.set_coordinate_x(stop.coordinates.lat);
 				raw_stop.set_coordinate_y(stop.coordinates.lng);
 
-				raw_stop.set_id(curent_id);
-
-				stops_to_stop_ids[&stop] = curent_id;
-				++curent_id;
+				raw_stop.set_id(stop.id);
 
 				*(result.add_stop()) = std::move(raw_stop);
 			}
@@ -343,8 +367,8 @@ namespace transport_catalogue_serialize {
 				raw_distance.set_distance(distance);
 
 				StopsPair raw_stops_pair;
-				raw_stops_pair.set_stop_id_1(stops_to_stop_ids.at(stops.first));
-				raw_stops_pair.set_stop_id_2(stops_to_stop_ids.at(stops.second));
+				raw_stops_pair.set_stop_id_1(stops.first);
+				raw_stops_pair.set_stop_id_2(stops.second);
 
 				*(raw_distance.mutable_stops()) = std::move(raw_stops_pair);
 				*(result.add_distances_between_stops()) = std::move(raw_distance);
@@ -352,17 +376,24 @@ namespace transport_catalogue_serialize {
 
 			for (const transport_catalogue::Bus& bus : catalogue.GetBuses()) {
 				Bus raw_bus;
-				raw_bus.set_name(bus.name);
+				raw_bus.set_name(std::string(bus.name));
 				raw_bus.set_is_ring_route(bus.is_ring_route);
 
+				raw_bus.set_stops_count(bus.stats.stops_count);
+				raw_bus.set_unique_stops_count(bus.stats.unique_stops_count);
+				raw_bus.set_route_length(bus.stats.route_length);
+				raw_bus.set_curvature(bus.stats.curvature);
+
 				for (const auto& stop : bus.GetStops()) {
-					raw_bus.add_stop_id(stops_to_stop_ids.at(stop));
+					raw_bus.add_stop_id(stop->id);
 				}
 
 				*(result.add_bus()) = std::move(raw_bus);
 			}
 
 
+			result.mutable_stop_id_by_name()->Add(catalogue.GetStopsByName().begin(), catalogue.GetStopsByName().end());
+
 			*(result.mutable_render_settings()) = ConvertMapRendererToRaw(renderer);
 			*(result.mutable_router()) = ConvertTransportRouterToRaw(router);
 
@@ -375,7 +406,7 @@ namespace transport_catalogue_serialize {
 			result.SetRoutingSettings(catalogue.bus_wait_time(), catalogue.bus_velocity());
 
 
-			std::unordered_map<uint32_t, transport_catalogue::Stop*> stop_ids_to_stops;
+			std::vector<transport_catalogue::Stop*> stop_ids_to_stops(catalogue.stop_size());
 
 			for (size_t index = 0; index < catalogue.stop_size(); ++index) {
 				const Stop& raw_stop = catalogue.stop(index);
@@ -390,20 +421,17 @@ namespace transport_catalogue_serialize {
 
 				transport_catalogue::Stop* stop = result.FindStop(raw_stop.name());
 
-				stop_ids_to_stops[raw_stop.id()] = stop;
+				stop_ids_to_stops.at(raw_stop.id()) = stop;
 			}
 
 
 			for (size_t index = 0; index < catalogue.distances_between_stops_size(); ++index) {
 				const DistanceBetweenStops& raw_distance = catalogue.distances_between_stops(index);
 
-				transport_catalogue::Stop* stop1 = stop_ids_to_stops[raw_distance.stops().stop_id_1()];
-				transport_catalogue::Stop* stop2 = stop_ids_to_stops[raw_distance.stops().stop_id_2()];
+				transport_catalogue::Stop* stop1 = stop_ids_to_stops.at(raw_distance.stops().stop_id_1());
+				transport_catalogue::Stop* stop2 = stop_ids_to_stops.at(raw_distance.stops().stop_id_2());
 
-				result.AddDistance(
-					stop1,
-					{ { stop2->name, raw_distance.distance() } }
-				);
+				result.AddDistance(stop1, stop2, raw_distance.distance());
 			}
 			for (size_t index = 0; index < catalogue.bus_size(); ++index) {
 				const Bus& raw_bus = catalogue.bus(index);
@@ -416,11 +444,25 @@ namespace transport_catalogue_serialize {
 				result.AddBus(
 					raw_bus.name(),
 					stops_names,
-					raw_bus.is_ring_route()
+					raw_bus.is_ring_route(),
+					transport_catalogue::BusStats{
+						raw_bus.stops_count(),
+						raw_bus.unique_stops_count(),
+						raw_bus.route_length(),
+						raw_bus.curvature()
+					}
 				);
 
 			}
 
+			// * a base written before the stop search index has no order of the names, it is sorted anew then
+			if (catalogue.stop_id_by_name_size() == catalogue.stop_size()) {
+				result.BuildIndexes({ catalogue.stop_id_by_name().begin(), catalogue.stop_id_by_name().end() });
+			}
+			else {
+				result.BuildIndexes();
+			}
+
 
 
 			return result;
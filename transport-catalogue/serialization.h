@@ -24,7 +24,15 @@ namespace transport_catalogue_serialize {
 
 
 		Graph ConvertGraphToRaw(const graph::DirectedWeightedGraph<transport_catalogue::TransportRouter::RouteWeight>& graph);
-		graph::DirectedWeightedGraph<transport_catalogue::TransportRouter::RouteWeight> ConvertRawGraphToNormal(const Graph& raw_graph, const transport_catalogue::Catalogue& catalogue);
+		graph::DirectedWeightedGraph<transport_catalogue::TransportRouter::RouteWeight> ConvertRawGraphToNormal(const Graph& raw_graph);
+
+		ContractionHierarchy ConvertContractionHierarchyToRaw(const graph::ContractionHierarchy<transport_catalogue::TransportRouter::RouteWeight>& hierarchy);
+		graph::ContractionHierarchy<transport_catalogue::TransportRouter::RouteWeight> ConvertRawContractionHierarchyToNormal(
+			const ContractionHierarchy& raw_hierarchy,
+			const graph::DirectedWeightedGraph<transport_catalogue::TransportRouter::RouteWeight>& graph);
+
+		HubLabels ConvertHubLabelsToRaw(const graph::HubLabels<transport_catalogue::TransportRouter::RouteWeight>::Labels& labels);
+		graph::HubLabels<transport_catalogue::TransportRouter::RouteWeight>::Labels ConvertRawHubLabelsToNormal(const HubLabels& raw_labels);
 
 		Router ConvertTransportRouterToRaw(const transport_catalogue::TransportRouter& router);
 		transport_catalogue::TransportRouter ConvertRawTransportRouterToNormal(
@@ -0,0 +1,146 @@
+#include "stop_name_index.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+using namespace std;
+
+
+
+namespace transport_catalogue {
+
+	StopNameIndex::StopNameIndex(const std::deque<Stop>& stops) {
+		stops_by_name_.resize(stops.size());
+		for (StopId id = 0; id < stops.size(); ++id) {
+			stops_by_name_[id] = id;
+		}
+		sort(stops_by_name_.begin(), stops_by_name_.end(), [&stops](StopId lhs, StopId rhs) {
+			return stops[lhs].name < stops[rhs].name;
+		});
+
+		names_.reserve(stops.size());
+		for (StopId id : stops_by_name_) {
+			names_.push_back(stops[id].name);
+		}
+	}
+
+	StopNameIndex::StopNameIndex(const std::deque<Stop>& stops, std::vector<StopId> stops_by_name)
+		: stops_by_name_(move(stops_by_name)) {
+		if (stops_by_name_.size() != stops.size()) {
+			throw invalid_argument("The stop name order should hold every stop");
+		}
+
+		names_.reserve(stops.size());
+		for (StopId id : stops_by_name_) {
+			names_.push_back(stops.at(id).name);
+		}
+		if (!is_sorted(names_.begin(), names_.end())) {
+			throw invalid_argument("The stop name order should be sorted by name");
+		}
+	}
+
+
+
+	std::vector<std::pair<StopId, size_t>> StopNameIndex::Find(std::string_view query, size_t max_distance, size_t limit) const {
+		const size_t row_size = query.size() + 1;
+
+		// * rows of the Levenshtein table for the prefixes of the current name one after another, row d is for the first d characters;
+		// neighbouring names share prefixes, whose rows are not computed again
+		vector<size_t> rows(row_size);
+		for (size_t j = 0; j < row_size; ++j) {
+			rows[j] = j;
+		}
+		// the smallest distance to the query among the prefixes up to length d
+		vector<size_t> path_best{ query.size() };
+		string_view computed_name;
+
+		// * positions follow the names, so sorting the pairs orders by the distance, then by the name
+		vector<pair<size_t, size_t>> matches;
+		auto add_matches = [&](size_t begin, size_t end, size_t distance) {
+			// * the rest of the range has the same distance and greater names, it cannot get into the first limit
+			end = min(end, begin + limit);
+			for (size_t position = begin; position < end; ++position) {
+				matches.emplace_back(distance, position);
+			}
+		};
+
+		for (size_t position = 0; position < names_.size();) {
+			const string_view name = names_[position];
+
+			size_t depth = 0;
+			const size_t common_length = min(computed_name.size(), name.size());
+			while (depth < common_length && computed_name[depth] == name[depth]) {
+				++depth;
+			}
+			rows.resize((depth + 1) * row_size);
+			path_best.resize(depth + 1);
+			computed_name = name;
+
+			bool is_range_done = false;
+			for (; depth < name.size(); ++depth) {
+				const size_t prev_row = depth * row_size;
+				rows.resize(rows.size() + row_size);
+				const size_t row = prev_row + row_size;
+
+				rows[row] = depth + 1;
+				size_t row_min = rows[row];
+				for (size_t j = 1; j < row_size; ++j) {
+					rows[row + j] = min({
+						rows[prev_row + j] + 1,
+						rows[row + j - 1] + 1,
+						rows[prev_row + j - 1] + (query[j - 1] == name[depth] ? 0 : 1) });
+					row_min = min(row_min, rows[row + j]);
+				}
+				path_best.push_back(min(path_best.back(), rows[row + query.size()]));
+
+				// * the row minimum does not decrease with the depth: either the whole subtree is beyond the limit,
+				// or the distance of every name with this prefix is already known
+				if (row_min > max_distance || path_best.back() <= row_min) {
+					const size_t range_end = GetPrefixRangeEnd(position, depth + 1);
+					if (path_best.back() <= max_distance) {
+						add_matches(position, range_end, path_best.back());
+					}
+					position = range_end;
+					is_range_done = true;
+					break;
+				}
+			}
+
+			if (is_range_done) {
+				continue;
+			}
+			if (path_best.back() <= max_distance) {
+				add_matches(position, position + 1, path_best.back());
+			}
+			++position;
+		}
+
+		sort(matches.begin(), matches.end());
+		if (matches.size() > limit) {
+			matches.resize(limit);
+		}
+
+		vector<pair<StopId, size_t>> result;
+		result.reserve(matches.size());
+		for (const auto& [distance, position] : matches) {
+			result.emplace_back(stops_by_name_[position], distance);
+		}
+
+		return result;
+	}
+
+	const std::vector<StopId>& StopNameIndex::GetStopsByName() const {
+		return stops_by_name_;
+	}
+
+
+
+	size_t StopNameIndex::GetPrefixRangeEnd(size_t position, size_t prefix_length) const {
+		const string_view prefix = names_[position].substr(0, prefix_length);
+
+		return partition_point(names_.begin() + position, names_.end(), [prefix](string_view name) {
+			return name.substr(0, prefix.size()) == prefix;
+		}) - names_.begin();
+	}
+
+}
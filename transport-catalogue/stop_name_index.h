@@ -0,0 +1,37 @@
+#pragma once
+
+#include "domain.h"
+
+#include <cstddef>
+#include <deque>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace transport_catalogue {
+
+	// stop names sorted byte by byte: the names with a common prefix are a contiguous range,
+	// so the array is walked like a trie, and only the order of the ids has to be stored in the base
+	class StopNameIndex {
+	public:
+		StopNameIndex() = default;
+		explicit StopNameIndex(const std::deque<Stop>& stops);
+		// stops_by_name is the order kept in the base, it has to hold every stop id once
+		StopNameIndex(const std::deque<Stop>& stops, std::vector<StopId> stops_by_name);
+
+		// stops whose names start with query at most max_distance edits away (Levenshtein distance to the closest prefix),
+		// sorted by the distance, then by the name; at most limit of them
+		std::vector<std::pair<StopId, size_t>> Find(std::string_view query, size_t max_distance, size_t limit) const;
+
+		const std::vector<StopId>& GetStopsByName() const;
+
+	private:
+		// the end of the range of the names that start with the prefix of the name at position
+		size_t GetPrefixRangeEnd(size_t position, size_t prefix_length) const;
+
+		std::vector<StopId> stops_by_name_;
+		// names in the same order, views into the names of the catalogue
+		std::vector<std::string_view> names_;
+	};
+
+}
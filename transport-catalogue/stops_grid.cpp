@@ -0,0 +1,263 @@
+#define _USE_MATH_DEFINES
+#include "stops_grid.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+using namespace std;
+
+
+
+namespace transport_catalogue {
+
+	namespace {
+		const double EARTH_RADIUS = 6371000.;
+		const double DEGREES_TO_RADIANS = M_PI / 180.;
+		// average number of stops in a cell
+		const size_t STOPS_PER_CELL = 2;
+	}
+
+
+	StopsGrid::StopsGrid(const std::deque<Stop>& stops) {
+		if (stops.empty()) {
+			return;
+		}
+
+		// * the grid starts after the widest empty arc of longitudes, so stops on both sides of the ±180° line stay neighbours
+		vector<double> longitudes;
+		longitudes.reserve(stops.size());
+		for (const Stop& stop : stops) {
+			longitudes.push_back(stop.coordinates.lng - 360. * floor((stop.coordinates.lng + 180.) / 360.));
+		}
+		sort(longitudes.begin(), longitudes.end());
+
+		min_lng_ = longitudes.front();
+		double widest_gap = longitudes.front() + 360. - longitudes.back();
+		for (size_t i = 1; i < longitudes.size(); ++i) {
+			if (longitudes[i] - longitudes[i - 1] > widest_gap) {
+				widest_gap = longitudes[i] - longitudes[i - 1];
+				min_lng_ = longitudes[i];
+			}
+		}
+
+		double max_lat = stops.front().coordinates.lat;
+		double max_lng = min_lng_;
+		min_lat_ = max_lat;
+		for (const Stop& stop : stops) {
+			min_lat_ = min(min_lat_, stop.coordinates.lat);
+			max_lat = max(max_lat, stop.coordinates.lat);
+			max_lng = max(max_lng, NormalizeLng(stop.coordinates.lng));
+		}
+		max_abs_lat_ = max(abs(min_lat_), abs(max_lat));
+
+		// * cells are roughly square on the ground: the longitude is shrunk by the cosine of the middle latitude
+		const double height = max(max_lat - min_lat_, 1e-9);
+		const double width = max((max_lng - min_lng_) * cos((min_lat_ + max_lat) / 2. * DEGREES_TO_RADIANS), 1e-9);
+		const double cell_count = max<double>(1., static_cast<double>(stops.size() / STOPS_PER_CELL));
+
+		lat_cell_count_ = clamp<size_t>(static_cast<size_t>(ceil(sqrt(cell_count * height / width))), 1, stops.size());
+		lng_cell_count_ = clamp<size_t>(static_cast<size_t>(ceil(cell_count / lat_cell_count_)), 1, stops.size());
+		cell_lat_ = height / lat_cell_count_;
+		cell_lng_ = max(max_lng - min_lng_, 1e-9) / lng_cell_count_;
+
+		// * stops are counted per cell, then placed
+		vector<uint32_t> stop_cells;
+		stop_cells.reserve(stops.size());
+		cell_offsets_.assign(lat_cell_count_ * lng_cell_count_ + 1, 0);
+		for (const Stop& stop : stops) {
+			const Cell cell = GetCell(stop.coordinates);
+			stop_cells.push_back(static_cast<uint32_t>(cell.lat_index * lng_cell_count_ + cell.lng_index));
+			++cell_offsets_[stop_cells.back() + 1];
+		}
+		for (size_t i = 1; i < cell_offsets_.size(); ++i) {
+			cell_offsets_[i] += cell_offsets_[i - 1];
+		}
+
+		stop_ids_.resize(stops.size());
+		vector<uint32_t> positions(cell_offsets_.begin(), cell_offsets_.end() - 1);
+		for (const Stop& stop : stops) {
+			stop_ids_[positions[stop_cells[stop.id]]++] = stop.id;
+		}
+		for (StopId id : stop_ids_) {
+			coordinates_.Add(stops[id].coordinates);
+		}
+	}
+
+
+
+	std::vector<std::pair<StopId, double>> StopsGrid::FindNearest(
+		geo::Coordinates point,
+		std::optional<size_t> count,
+		std::optional<double> radius) const
+	{
+		if (!count && !radius) {
+			throw invalid_argument("Either the count or the radius of the nearest stops is required");
+		}
+
+		vector<pair<double, StopId>> result;
+		if (stop_ids_.empty() || (count && *count == 0)) {
+			return {};
+		}
+
+		const geo::HalfAngleCoordinates prepared_point = geo::PrepareHalfAngles(point);
+		vector<double> distances;
+		point.lng = NormalizeLng(point.lng);
+		const double min_cos_lat = cos(min(max(max_abs_lat_, abs(point.lat)), 90.) * DEGREES_TO_RADIANS);
+
+		// * with count the result is a heap with the farthest stop found on top
+		auto get_threshold = [&]() {
+			double threshold = radius ? *radius : numeric_limits<double>::infinity();
+			if (count && result.size() == *count) {
+				threshold = min(threshold, result.front().first);
+			}
+			return threshold;
+		};
+
+		auto visit_cell = [&](size_t lat_index, size_t lng_index) {
+			if (GetDistanceLowerBound(point, min_cos_lat, lat_index, lng_index) > get_threshold()) {
+				return;
+			}
+
+			const size_t cell = lat_index * lng_cell_count_ + lng_index;
+			coordinates_.ComputeDistances(prepared_point, cell_offsets_[cell], cell_offsets_[cell + 1], distances);
+			for (uint32_t position = cell_offsets_[cell]; position < cell_offsets_[cell + 1]; ++position) {
+				const double distance = distances[position - cell_offsets_[cell]];
+				if (distance > get_threshold()) {
+					continue;
+				}
+
+				result.emplace_back(distance, stop_ids_[position]);
+				if (count) {
+					push_heap(result.begin(), result.end());
+					if (result.size() > *count) {
+						pop_heap(result.begin(), result.end());
+						result.pop_back();
+					}
+				}
+			}
+		};
+
+		// * rings of cells around the point, the search ends once the cells outside the visited rings are all too far
+		const Cell center = GetCell(point);
+
+		for (size_t ring = 0;; ++ring) {
+			const long long lat_begin = static_cast<long long>(center.lat_index) - static_cast<long long>(ring);
+			const long long lat_end = static_cast<long long>(center.lat_index) + static_cast<long long>(ring);
+			const long long lng_begin = static_cast<long long>(center.lng_index) - static_cast<long long>(ring);
+			const long long lng_end = static_cast<long long>(center.lng_index) + static_cast<long long>(ring);
+
+			for (long long lat_index = max(lat_begin, 0LL); lat_index <= min(lat_end, static_cast<long long>(lat_cell_count_) - 1); ++lat_index) {
+				const bool is_edge_row = lat_index == lat_begin || lat_index == lat_end;
+				// * inside the ring only its first and last columns
+				const long long lng_step = is_edge_row ? 1 : max(lng_end - lng_begin, 1LL);
+
+				for (long long lng_index = lng_begin; lng_index <= lng_end; lng_index += lng_step) {
+					if (lng_index < 0 || lng_index >= static_cast<long long>(lng_cell_count_)) {
+						continue;
+					}
+					visit_cell(static_cast<size_t>(lat_index), static_cast<size_t>(lng_index));
+				}
+			}
+
+			const optional<double> outside_bound = GetOutsideLowerBound(point, min_cos_lat,
+				{ static_cast<size_t>(max(lat_begin, 0LL)), static_cast<size_t>(max(lng_begin, 0LL)) },
+				{ static_cast<size_t>(min(lat_end, static_cast<long long>(lat_cell_count_) - 1)), static_cast<size_t>(min(lng_end, static_cast<long long>(lng_cell_count_) - 1)) });
+			if (!outside_bound || *outside_bound > get_threshold()) {
+				break;
+			}
+		}
+
+		sort(result.begin(), result.end());
+
+		vector<pair<StopId, double>> stops;
+		stops.reserve(result.size());
+		for (const auto& [distance, stop_id] : result) {
+			stops.emplace_back(stop_id, distance);
+		}
+
+		return stops;
+	}
+
+
+
+	StopsGrid::Cell StopsGrid::GetCell(geo::Coordinates coordinates) const {
+		const double lat_index = floor((coordinates.lat - min_lat_) / cell_lat_);
+		const double lng_index = floor((NormalizeLng(coordinates.lng) - min_lng_) / cell_lng_);
+
+		return {
+			static_cast<size_t>(clamp(lat_index, 0., static_cast<double>(lat_cell_count_ - 1))),
+			static_cast<size_t>(clamp(lng_index, 0., static_cast<double>(lng_cell_count_ - 1)))
+		};
+	}
+
+	double StopsGrid::NormalizeLng(double lng) const {
+		return lng - 360. * floor((lng - min_lng_) / 360.);
+	}
+
+	double StopsGrid::GetLngGap(double lng, double begin, double end) {
+		if (begin <= lng && lng <= end) {
+			return 0.;
+		}
+
+		// * outside the arc the nearest point of it is one of its ends, either way around the globe
+		auto get_arc = [lng](double other_lng) {
+			const double difference = fmod(abs(lng - other_lng), 360.);
+			return min(difference, 360. - difference);
+		};
+		return min(get_arc(begin), get_arc(end));
+	}
+
+	double StopsGrid::GetLatBound(double lat_gap) {
+		// the meridian arc is not longer than the path
+		return EARTH_RADIUS * lat_gap * DEGREES_TO_RADIANS;
+	}
+
+	double StopsGrid::GetLngBound(double lng_gap, double min_cos_lat) {
+		// the parallel chord at the latitude with the smallest cosine is not longer than the chord between the points
+		return EARTH_RADIUS * min_cos_lat * 2. * sin(lng_gap * DEGREES_TO_RADIANS / 2.);
+	}
+
+	double StopsGrid::WithMargin(double bound) {
+		// * a small margin against rounding errors, the stops may lie a rounding error outside their cells
+		return max(0., bound * (1. - 1e-9) - 1e-6);
+	}
+
+	double StopsGrid::GetDistanceLowerBound(geo::Coordinates point, double min_cos_lat, size_t lat_index, size_t lng_index) const {
+		const double cell_lat_begin = min_lat_ + lat_index * cell_lat_;
+		const double cell_lng_begin = min_lng_ + lng_index * cell_lng_;
+
+		const double lat_gap = max({ 0., cell_lat_begin - point.lat, point.lat - (cell_lat_begin + cell_lat_) });
+		const double lng_gap = GetLngGap(point.lng, cell_lng_begin, cell_lng_begin + cell_lng_);
+
+		return WithMargin(max(GetLatBound(lat_gap), GetLngBound(lng_gap, min_cos_lat)));
+	}
+
+	std::optional<double> StopsGrid::GetOutsideLowerBound(geo::Coordinates point, double min_cos_lat, Cell first, Cell last) const {
+		optional<double> result;
+		auto add_bound = [&result](double bound) {
+			result = result ? min(*result, bound) : bound;
+		};
+
+		// * every side of the rectangle of cells is bounded on its own: a row below it, a row above it, a column to the left or to the right
+		if (first.lat_index > 0) {
+			add_bound(GetLatBound(max(0., point.lat - (min_lat_ + first.lat_index * cell_lat_))));
+		}
+		if (last.lat_index + 1 < lat_cell_count_) {
+			add_bound(GetLatBound(max(0., min_lat_ + (last.lat_index + 1) * cell_lat_ - point.lat)));
+		}
+		if (first.lng_index > 0) {
+			add_bound(GetLngBound(GetLngGap(point.lng, min_lng_, min_lng_ + first.lng_index * cell_lng_), min_cos_lat));
+		}
+		if (last.lng_index + 1 < lng_cell_count_) {
+			add_bound(GetLngBound(GetLngGap(point.lng, min_lng_ + (last.lng_index + 1) * cell_lng_, min_lng_ + lng_cell_count_ * cell_lng_), min_cos_lat));
+		}
+
+		if (result) {
+			result = WithMargin(*result);
+		}
+		return result;
+	}
+
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "geo.h"
+#include "domain.h"
+
+#include <deque>
+#include <optional>
+#include <utility>
+#include <vector>
+
+namespace transport_catalogue {
+
+	// uniform latitude/longitude grid over the stops, built once the stops are known;
+	// cells are searched ring by ring around the point and skipped by a lower bound of the distance,
+	// only the stops of the cells that may be close enough are measured with geo::CoordinatesBatch;
+	// the longitudes start after the widest arc without stops, so a network across the ±180° line is not split
+	class StopsGrid {
+	public:
+		StopsGrid() = default;
+		explicit StopsGrid(const std::deque<Stop>& stops);
+
+		// the count nearest stops (all of them without count) not farther than radius metres (any distance without radius),
+		// sorted by the distance; at least one of the limits is required
+		std::vector<std::pair<StopId, double>> FindNearest(
+			geo::Coordinates point,
+			std::optional<size_t> count,
+			std::optional<double> radius) const;
+
+	private:
+		struct Cell {
+			size_t lat_index = 0;
+			size_t lng_index = 0;
+		};
+
+		Cell GetCell(geo::Coordinates coordinates) const;
+		// the longitude shifted by a whole turn into [min_lng_, min_lng_ + 360)
+		double NormalizeLng(double lng) const;
+		// degrees from the longitude to the nearest point of the arc [begin, end], the shorter way around
+		static double GetLngGap(double lng, double begin, double end);
+		static double GetLatBound(double lat_gap);
+		static double GetLngBound(double lng_gap, double min_cos_lat);
+		static double WithMargin(double bound);
+
+		// no stop of the cell is closer to the point than the result, the point longitude is normalized
+		double GetDistanceLowerBound(geo::Coordinates point, double min_cos_lat, size_t lat_index, size_t lng_index) const;
+		// no stop outside the cells [first, last] is closer to the point than the result, nullopt if no cell is outside
+		std::optional<double> GetOutsideLowerBound(geo::Coordinates point, double min_cos_lat, Cell first, Cell last) const;
+
+		double min_lat_ = 0.;
+		// longitude where the grid starts, the stop longitudes are normalized to [min_lng_, min_lng_ + 360)
+		double min_lng_ = 0.;
+		double max_abs_lat_ = 0.;
+		double cell_lat_ = 1.;
+		double cell_lng_ = 1.;
+		size_t lat_cell_count_ = 0;
+		size_t lng_cell_count_ = 0;
+
+		// stops of the cell lat_index * lng_cell_count_ + lng_index are [cell_offsets_[cell], cell_offsets_[cell + 1])
+		std::vector<uint32_t> cell_offsets_;
+		std::vector<StopId> stop_ids_;
+		// coordinates of the stops in the same order, a cell is measured with one batch call
+		geo::CoordinatesBatch coordinates_;
+	};
+
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstring>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+namespace transport_catalogue {
+
+	// owner of the names of the catalogue: the characters are stored one after another in large blocks,
+	// a stored name keeps its view for the lifetime of the pool, moves included; the pool is only a storage arena,
+	// the names are referred to by these views, equal names are not merged
+	class StringPool {
+	public:
+		StringPool() = default;
+		StringPool(StringPool&&) = default;
+		StringPool& operator=(StringPool&&) = default;
+		// * a copy would have to rebind every view into the pool
+		StringPool(const StringPool&) = delete;
+		StringPool& operator=(const StringPool&) = delete;
+
+		std::string_view Store(std::string_view value) {
+			if (value.empty()) {
+				return {};
+			}
+
+			// * a name longer than a block gets a block of its own, the current one keeps being filled
+			if (value.size() > BLOCK_SIZE) {
+				char* data = large_blocks_.emplace_back(std::make_unique<char[]>(value.size())).get();
+				std::memcpy(data, value.data(), value.size());
+				return { data, value.size() };
+			}
+
+			if (blocks_.empty() || block_used_ + value.size() > BLOCK_SIZE) {
+				blocks_.push_back(std::make_unique<char[]>(BLOCK_SIZE));
+				block_used_ = 0;
+			}
+
+			char* data = blocks_.back().get() + block_used_;
+			std::memcpy(data, value.data(), value.size());
+			block_used_ += value.size();
+
+			return { data, value.size() };
+		}
+
+	private:
+		static constexpr size_t BLOCK_SIZE = 64 * 1024;
+
+		std::vector<std::unique_ptr<char[]>> blocks_;
+		std::vector<std::unique_ptr<char[]>> large_blocks_;
+		size_t block_used_ = 0;
+	};
+
+}
@@ -1,5 +1,7 @@
 #include "transport_catalogue.h"
 
+#include <algorithm>
+
 using namespace std;
 
 
@@ -15,14 +17,6 @@ namespace transport_catalogue {
 	}
 
 
-	Catalogue::StopsPairHasher::StopsPairHasher() : N(42) {}
-
-	size_t Catalogue::StopsPairHasher::operator()(std::pair<Stop*, Stop*> stops) const {
-		size_t hash1 = hash<string>{}((*stops.first).name);
-		size_t hash2 = hash<string>{}((*stops.second).name);
-
-		return hash1 + hash2 * N;
-	}
 
 
 
@@ -31,42 +25,109 @@ namespace transport_catalogue {
 		stops_.push_back(stop);
 
 		Stop& added_stop = stops_.back();
+		added_stop.name = names_.Store(stop.name);
+		added_stop.id = static_cast<StopId>(stops_.size() - 1);
+		stops_coordinates_.Add(added_stop.coordinates);
 		stopname_to_stop_[added_stop.name] = &added_stop;
-		stop_to_buses_[added_stop.name];
+		ResetStopToBusesIndex();
+		stops_grid_.reset();
+		stop_name_index_.reset();
 	}
 
 	void Catalogue::AddStop(string_view stop_name, geo::Coordinates coordinates) {
-		AddStop(Stop{ string(stop_name), coordinates });
+		AddStop(Stop{ stop_name, coordinates });
 	}
 
 
 	// - добавление маршрута в базу
 	void Catalogue::AddBus(std::string_view bus_name, const vector<std::string_view>& stops, bool is_ring_route) {
+		Bus bus = MakeBus(bus_name, stops, is_ring_route);
+		bus.stats = CalculateBusStats(bus);
+
+		InsertBus(move(bus));
+	}
+
+	void Catalogue::AddBus(std::string_view bus_name, const vector<std::string_view>& stops, bool is_ring_route, const BusStats& stats) {
+		Bus bus = MakeBus(bus_name, stops, is_ring_route);
+		bus.stats = stats;
+
+		InsertBus(move(bus));
+	}
+
+	void Catalogue::InsertBus(Bus&& bus) {
+		buses_.push_back(move(bus));
+
+		Bus& added_bus = buses_.back();
+		added_bus.id = static_cast<BusId>(buses_.size() - 1);
+		busname_to_bus_[added_bus.name] = &added_bus;
+		ResetStopToBusesIndex();
+	}
+
+	// - замена маршрута
+	void Catalogue::UpdateBus(std::string_view bus_name, const vector<std::string_view>& stops, bool is_ring_route) {
+		Bus* bus = FindBus(bus_name);
+		if (bus == nullptr) {
+			AddBus(bus_name, stops, is_ring_route);
+			return;
+		}
+
+		// * имя остаётся прежним: на него ссылается ключ busname_to_bus_
+		Bus updated_bus = MakeBus(bus_name, stops, is_ring_route);
+		bus->stops = move(updated_bus.stops);
+		bus->keys_for_distance = move(updated_bus.keys_for_distance);
+		bus->geo_distance = updated_bus.geo_distance;
+		bus->is_ring_route = updated_bus.is_ring_route;
+		bus->stats = CalculateBusStats(*bus);
+		ResetStopToBusesIndex();
+	}
+
+	// - удаление маршрута
+	bool Catalogue::RemoveBus(std::string_view bus_name) {
+		Bus* bus = FindBus(bus_name);
+		if (bus == nullptr) {
+			return false;
+		}
+
+		// * удаление из середины deque перемещает маршруты, номера и индексы строятся заново
+		buses_.erase(buses_.begin() + bus->id);
+
+		busname_to_bus_.clear();
+		for (BusId id = 0; id < buses_.size(); ++id) {
+			Bus& added_bus = buses_[id];
+			added_bus.id = id;
+			busname_to_bus_[added_bus.name] = &added_bus;
+		}
+		ResetStopToBusesIndex();
+
+		return true;
+	}
+
+	Bus Catalogue::MakeBus(std::string_view bus_name, const vector<std::string_view>& stops, bool is_ring_route) {
 		Bus bus_to_add;
 
-		bus_to_add.name = string(bus_name);
+		bus_to_add.name = names_.Store(bus_name);
 		bus_to_add.is_ring_route = is_ring_route;
 
-		vector<Stop*> stops_on_the_route;
-		Stop* prev_stop = nullptr;
-
+		vector<Stop*> route_stops;
+		vector<uint32_t> route_stop_ids;
+		route_stops.reserve(stops.size());
+		route_stop_ids.reserve(stops.size());
 		for (string_view stop : stops) {
-			Stop* stop_to_add = FindStop(stop);
+			route_stops.push_back(FindStop(stop));
+			route_stop_ids.push_back(route_stops.back()->id);
+		}
 
-			stops_on_the_route.push_back(stop_to_add);
+		// * расстояния по прямой между соседними остановками считаются одним проходом
+		const vector<double> geo_distances = stops_coordinates_.ComputePolylineDistances(route_stop_ids);
 
-			if (prev_stop != nullptr) {
-				double geo_distance_to_add = ComputeDistance((*prev_stop).coordinates, (*stop_to_add).coordinates);
+		Stop* prev_stop = nullptr;
 
-				if (!distance_between_stops_.count({ prev_stop, stop_to_add })) {
-					distance_between_stops_.insert({ {prev_stop, stop_to_add}, geo_distance_to_add });
-				}
-				if (!is_ring_route and !distance_between_stops_.count({ stop_to_add, prev_stop })) {
-					distance_between_stops_.insert({ {stop_to_add, prev_stop}, geo_distance_to_add });
-				}
+		for (size_t i = 0; i < route_stops.size(); ++i) {
+			Stop* stop_to_add = route_stops[i];
 
+			if (prev_stop != nullptr) {
 				bus_to_add.keys_for_distance.push_back({ prev_stop, stop_to_add });
-				bus_to_add.geo_distance += geo_distance_to_add;
+				bus_to_add.geo_distance += geo_distances[i - 1];
 			}
 
 			bus_to_add.stops.insert(stop_to_add);
@@ -75,14 +136,7 @@ namespace transport_catalogue {
 		}
 		bus_to_add.geo_distance *= is_ring_route ? 1 : 2;
 
-		buses_.push_back(move(bus_to_add));
-
-		Bus& added_bus = buses_.back();
-		busname_to_bus_[added_bus.name] = &added_bus;
-
-		for (Stop* stop : stops_on_the_route) {
-			stop_to_buses_[stop->name].insert(added_bus.name);
-		}
+		return bus_to_add;
 	}
 
 
@@ -107,22 +161,23 @@ namespace transport_catalogue {
 
 	// - получение информации о маршруте
 	std::optional<BusInfo> Catalogue::GetBusInfo(std::string_view bus_name) const {
-		BusInfo result;
-
-		Bus* bus_ptr = FindBus(bus_name);
-		if (bus_ptr == nullptr) {
+		Bus* bus = FindBus(bus_name);
+		if (bus == nullptr) {
 			return nullopt;
 		}
 
-		Bus& bus = *bus_ptr;
+		return BusInfo{ bus->name, bus->stats.stops_count, bus->stats.unique_stops_count, bus->stats.route_length, bus->stats.curvature };
+	}
+
+	BusStats Catalogue::CalculateBusStats(const Bus& bus) const {
+		BusStats result;
 
-		result.name = bus.name;
 		result.stops_count = bus.is_ring_route ? (bus.keys_for_distance.size() + 1) : ((bus.keys_for_distance.size() + 1) * 2) - 1;
 		result.unique_stops_count = bus.stops.size();
 
 		for (const auto& key : bus.keys_for_distance) {
-			result.route_length += distance_between_stops_.at(key);
-			result.route_length += bus.is_ring_route ? 0 : distance_between_stops_.at({ key.second, key.first });
+			result.route_length += GetRoadDistance(key.first->id, key.second->id);
+			result.route_length += bus.is_ring_route ? 0 : GetRoadDistance(key.second->id, key.first->id);
 		}
 
 		result.curvature = result.route_length / bus.geo_distance;
@@ -134,18 +189,33 @@ namespace transport_catalogue {
 	//добавление дистанции в базу
 	void Catalogue::AddDistance(Stop* stop, const unordered_map<std::string_view, double>& distanses) {
 		for (const auto& [stop_name, distance] : distanses) {
-			Stop* stop_dis = FindStop(stop_name);
+			AddDistance(stop, FindStop(stop_name), distance);
+		}
+	}
 
-			distance_between_stops_[{stop, stop_dis}] = distance;
+	void Catalogue::AddDistance(Stop* stop, Stop* stop_to, double distance) {
+		distance_between_stops_.Set(stop->id, stop_to->id, distance);
 
-			if (!distance_between_stops_.count({ stop_dis, stop })) {
-				distance_between_stops_[{stop_dis, stop}] = distance;
+		// * маршруты, уже проходящие через обе остановки, пересчитываются (при заполнении базы дистанции идут до маршрутов)
+		for (Bus& bus : buses_) {
+			if (bus.stops.count(stop) && bus.stops.count(stop_to)) {
+				bus.stats = CalculateBusStats(bus);
 			}
 		}
 	}
 
 	double Catalogue::GetDistance(std::pair<Stop*, Stop*> stops) {
-		return distance_between_stops_.at(stops);
+		return GetRoadDistance(stops.first->id, stops.second->id);
+	}
+
+	double Catalogue::GetRoadDistance(StopId from, StopId to) const {
+		if (const double* distance = distance_between_stops_.Find(from, to)) {
+			return *distance;
+		}
+		if (const double* distance = distance_between_stops_.Find(to, from)) {
+			return *distance;
+		}
+		return stops_coordinates_.ComputeDistance(from, to);
 	}
 	double Catalogue::GetDistance(Stop* stop1, Stop* stop2) {
 		return GetDistance({ stop1, stop2 });
@@ -154,11 +224,98 @@ namespace transport_catalogue {
 
 	//получение информации об остановке
 	std::optional<StopsBuses> Catalogue::GetBusesByStop(std::string_view stop_name) const {
-		if (!stop_to_buses_.count(stop_name)) {
+		Stop* stop = FindStop(stop_name);
+		if (stop == nullptr) {
 			return nullopt;
 		}
+		if (stop_to_buses_offsets_.empty()) {
+			throw logic_error("The stop to buses index should be built");
+		}
+
+		const BusId* buses = stop_to_buses_.data();
+		return StopsBuses{ buses + stop_to_buses_offsets_[stop->id], buses + stop_to_buses_offsets_[stop->id + 1] };
+	}
+
+	//поиск ближайших остановок
+	std::vector<std::pair<const Stop*, double>> Catalogue::FindNearestStops(geo::Coordinates point, std::optional<size_t> count, std::optional<double> radius) const {
+		if (!stops_grid_) {
+			throw logic_error("The stops grid should be built");
+		}
+
+		std::vector<std::pair<const Stop*, double>> result;
+		for (const auto& [id, distance] : stops_grid_->FindNearest(point, count, radius)) {
+			result.emplace_back(&stops_[id], distance);
+		}
+		return result;
+	}
+
+	//поиск остановок по имени
+	std::vector<std::pair<const Stop*, size_t>> Catalogue::SearchStops(std::string_view query, size_t max_distance, size_t limit) const {
+		if (!stop_name_index_) {
+			throw logic_error("The stop name index should be built");
+		}
+
+		std::vector<std::pair<const Stop*, size_t>> result;
+		for (const auto& [id, distance] : stop_name_index_->Find(query, max_distance, limit)) {
+			result.emplace_back(&stops_[id], distance);
+		}
+		return result;
+	}
+
+	void Catalogue::BuildIndexes() {
+		BuildStopToBusesIndex();
+		stops_grid_.emplace(stops_);
+		stop_name_index_.emplace(stops_);
+	}
+
+	void Catalogue::BuildIndexes(std::vector<StopId> stops_by_name) {
+		BuildStopToBusesIndex();
+		stops_grid_.emplace(stops_);
+		stop_name_index_.emplace(stops_, move(stops_by_name));
+	}
+
+	const std::vector<StopId>& Catalogue::GetStopsByName() const {
+		if (!stop_name_index_) {
+			throw logic_error("The stop name index should be built");
+		}
+		return stop_name_index_->GetStopsByName();
+	}
+
+	void Catalogue::BuildStopToBusesIndex() {
+		vector<BusId> buses_by_name(buses_.size());
+		for (BusId id = 0; id < buses_.size(); ++id) {
+			buses_by_name[id] = id;
+		}
+		sort(buses_by_name.begin(), buses_by_name.end(), [this](BusId lhs, BusId rhs) {
+			return buses_[lhs].name < buses_[rhs].name;
+		});
+
+		// * подсчёт маршрутов каждой остановки, затем раскладка по местам: маршруты в порядке имён, поэтому срезы уже отсортированы
+		vector<uint32_t> offsets(stops_.size() + 1, 0);
+		for (const Bus& bus : buses_) {
+			for (const Stop* stop : bus.stops) {
+				++offsets[stop->id + 1];
+			}
+		}
+		for (size_t i = 1; i < offsets.size(); ++i) {
+			offsets[i] += offsets[i - 1];
+		}
+
+		vector<BusId> stop_to_buses(offsets.back());
+		vector<uint32_t> positions(offsets.begin(), offsets.end() - 1);
+		for (BusId id : buses_by_name) {
+			for (const Stop* stop : buses_[id].stops) {
+				stop_to_buses[positions[stop->id]++] = id;
+			}
+		}
+
+		stop_to_buses_offsets_ = move(offsets);
+		stop_to_buses_ = move(stop_to_buses);
+	}
 
-		return stop_to_buses_.at(stop_name);
+	void Catalogue::ResetStopToBusesIndex() {
+		stop_to_buses_offsets_.clear();
+		stop_to_buses_.clear();
 	}
 
 
@@ -179,7 +336,7 @@ namespace transport_catalogue {
 		return stops_;
 	}
 
-	const std::unordered_map<std::pair<Stop*, Stop*>, double, Catalogue::StopsPairHasher>& Catalogue::GetDistances() const {
+	const Catalogue::Distances& Catalogue::GetDistances() const {
 		return distance_between_stops_;
 	}
 
@@ -193,7 +350,7 @@ namespace transport_catalogue {
 	}
 
 	Minutes Catalogue::GetBusRideTime(std::pair<Stop*, Stop*> stops) const {
-		return HoursToMinutes(KilometresToMetres(distance_between_stops_.at(stops)) / bus_velocity_);
+		return HoursToMinutes(KilometresToMetres(GetRoadDistance(stops.first->id, stops.second->id)) / bus_velocity_);
 	}
 
 	Minutes Catalogue::GetBusRideTime(Stop* stop1, Stop* stop2) const {
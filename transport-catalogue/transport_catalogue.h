@@ -2,6 +2,10 @@
 
 #include "geo.h"
 #include "domain.h"
+#include "distance_table.h"
+#include "string_pool.h"
+#include "stops_grid.h"
+#include "stop_name_index.h"
 
 #include <string>
 #include <string_view>
@@ -19,12 +23,8 @@ namespace transport_catalogue {
 	using BusVelocity = double;
 
 	class Catalogue final {
-		struct StopsPairHasher {
-			StopsPairHasher();
-			const size_t N = 24;
-			size_t operator()(std::pair<Stop*, Stop*> stops) const;
-		};
 	public:
+		using Distances = DistanceTable;
 
 		Catalogue() = default;
 		Catalogue(Minutes bus_wait_time, BusVelocity bus_velocity);
@@ -36,9 +36,17 @@ namespace transport_catalogue {
 
 		//добавление маршрута в базу
 		void AddBus(std::string_view bus_name, const std::vector<std::string_view>& stops, bool is_ring_route);
+		//добавление маршрута с уже посчитанной статистикой (из файла базы)
+		void AddBus(std::string_view bus_name, const std::vector<std::string_view>& stops, bool is_ring_route, const BusStats& stats);
+		//замена остановок маршрута (или добавление, если его нет), маршрут остаётся на своём месте в базе
+		void UpdateBus(std::string_view bus_name, const std::vector<std::string_view>& stops, bool is_ring_route);
+		//удаление маршрута, false если его нет
+		bool RemoveBus(std::string_view bus_name);
 
 		//добавление дистанции в базу
 		void AddDistance(Stop* stop, const std::unordered_map<std::string_view, double>& distanses);
+		//дистанция от stop до stop_to; пока обратная не задана, она берётся такой же
+		void AddDistance(Stop* stop, Stop* stop_to, double distance);
 		double GetDistance(std::pair<Stop*, Stop*> stops);
 		double GetDistance(Stop* stop1, Stop* stop2);
 
@@ -51,15 +59,29 @@ namespace transport_catalogue {
 		//получение информации о маршруте
 		std::optional<BusInfo> GetBusInfo(std::string_view bus_name) const;
 
-		//получение информации об остановке
+		//получение информации об остановке: номера маршрутов по возрастанию имени, без копирования
 		std::optional<StopsBuses> GetBusesByStop(std::string_view stop_name) const;
 
+		//ближайшие к точке остановки: не больше count и не дальше radius метров, по возрастанию расстояния
+		std::vector<std::pair<const Stop*, double>> FindNearestStops(geo::Coordinates point, std::optional<size_t> count, std::optional<double> radius) const;
+
+		//поиск остановок по началу имени с опечатками: не больше max_distance правок, не больше limit остановок
+		std::vector<std::pair<const Stop*, size_t>> SearchStops(std::string_view query, size_t max_distance, size_t limit) const;
+
+		//построение индексов (остановка -> маршруты, сетка остановок, имена остановок) после заполнения базы, изменения остановок и маршрутов их сбрасывают
+		void BuildIndexes();
+		//то же, порядок остановок по именам берётся готовым из файла базы
+		void BuildIndexes(std::vector<StopId> stops_by_name);
+		//номера остановок по возрастанию имени
+		const std::vector<StopId>& GetStopsByName() const;
+
 
 		size_t GetStopsCount() const;
 		size_t GetBusesCount() const;
 		const std::deque<Bus>& GetBuses() const;
 		const std::deque<Stop>& GetStops() const;
-		const std::unordered_map<std::pair<Stop*, Stop*>, double, StopsPairHasher>& GetDistances() const;
+		// только заданные дистанции, ключи - номера остановок
+		const Distances& GetDistances() const;
 
 		Minutes GetWaitTime() const;
 		BusVelocity GetBusVelocity() const;
@@ -72,14 +94,37 @@ namespace transport_catalogue {
 		Minutes bus_wait_time_ = 0.;
 		BusVelocity bus_velocity_ = 1.;
 
+		//все имена базы подряд в общих блоках, представления в Stop, Bus и индексах не меняются до удаления базы
+		StringPool names_;
 		std::deque<Stop> stops_;
+		//координаты остановок в порядке номеров для пакетного расчёта расстояний
+		geo::CoordinatesBatch stops_coordinates_;
 		std::deque<Bus> buses_;
 		std::unordered_map<std::string_view, Stop*> stopname_to_stop_;
 		std::unordered_map<std::string_view, Bus*> busname_to_bus_;
-		std::unordered_map<std::pair<Stop*, Stop*>, double, StopsPairHasher> distance_between_stops_;
-		std::unordered_map<std::string_view, std::set<std::string_view>> stop_to_buses_;
-
-
+		// * имена хешируются только на входе запроса, дальше поиск идёт по номерам;
+		// здесь только дистанции из запросов, расстояния по прямой сюда не пишутся, иначе они закрыли бы обратные дистанции, заданные позже
+		Distances distance_between_stops_;
+		//индекс остановка -> маршруты в форме CSR: маршруты остановки i лежат в stop_to_buses_[offsets[i], offsets[i + 1])
+		std::vector<uint32_t> stop_to_buses_offsets_;
+		std::vector<BusId> stop_to_buses_;
+		//сетка координат остановок для поиска ближайших
+		std::optional<StopsGrid> stops_grid_;
+		//отсортированные имена остановок для поиска по началу имени
+		std::optional<StopNameIndex> stop_name_index_;
+
+
+
+		//дистанция от from до to: заданная, иначе заданная в обратную сторону, иначе по прямой
+		double GetRoadDistance(StopId from, StopId to) const;
+		//сборка маршрута без регистрации в базе
+		Bus MakeBus(std::string_view bus_name, const std::vector<std::string_view>& stops, bool is_ring_route);
+		//регистрация маршрута в индексах базы
+		void InsertBus(Bus&& bus);
+		//подсчёт статистики по дистанциям маршрута
+		BusStats CalculateBusStats(const Bus& bus) const;
+		void BuildStopToBusesIndex();
+		void ResetStopToBusesIndex();
 
 		static double KilometresToMetres(double length_in_metres);
 		static Minutes HoursToMinutes(double time_in_hours);
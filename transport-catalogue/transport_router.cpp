@@ -1,88 +1,528 @@
 #include "transport_router.h"
 
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include <tuple>
+#include <thread>
+
 
 namespace transport_catalogue {
 
 
-	TransportRouter::TransportRouter(const Catalogue& catalogue) : catalogue_(catalogue), stop_name_to_id_(), router_(InitGraph()) { }
+	TransportRouter::TransportRouter(const Catalogue& catalogue, const RoutingSettings& settings)
+		: catalogue_(catalogue)
+		, settings_(settings)
+		, vertex_stop_ids_()
+		, edge_infos_()
+		, router_(BuildEngine(InitGraph(), catalogue_, settings_, vertex_stop_ids_))
+		, route_cache_(MakeRouteCache(settings_))
+		, search_mutex_(std::make_unique<std::mutex>()) { }
 
 	TransportRouter::TransportRouter(const Catalogue& catalogue
 		, graph::DirectedWeightedGraph<RouteWeight>& graph
-		, graph::Router<RouteWeight>::RoutesInternalData&& routes_internal_data
-		, std::unordered_map<std::string_view, size_t>&& stop_name_to_id)
+		, const RoutingSettings& settings
+		, Engine&& engine
+		, std::vector<size_t>&& vertex_stop_ids
+		, std::vector<EdgeInfo>&& edge_infos)
 		: catalogue_(catalogue),
 		graph_(&graph),
-		router_(*graph_, std::move(routes_internal_data)),
-		stop_name_to_id_(stop_name_to_id)
-	{ }
+		settings_(settings),
+		vertex_stop_ids_(std::move(vertex_stop_ids)),
+		edge_infos_(std::move(edge_infos)),
+		router_(std::move(engine)),
+		route_cache_(MakeRouteCache(settings_)),
+		search_mutex_(std::make_unique<std::mutex>())
+	{
+		if (edge_infos_.size() != graph.GetEdgeCount()) {
+			throw std::invalid_argument("Edge infos do not match the graph");
+		}
+	}
+
+
+	TransportRouter::TransportRouter(const Catalogue& catalogue
+		, TransportRouter&& previous
+		, const std::vector<EdgeKey>& previous_edge_keys)
+		: catalogue_(catalogue)
+		, settings_(previous.settings_)
+		, vertex_stop_ids_()
+		, edge_infos_()
+		, router_(RepairEngine(InitGraph(), std::move(previous.router_), previous_edge_keys))
+		, route_cache_(MakeRouteCache(settings_))
+		, search_mutex_(std::make_unique<std::mutex>())
+		, is_engine_repaired_(CanRepairEngine(router_, settings_)) { }
+
+
+	TransportRouter::Engine TransportRouter::BuildEngine(
+		const graph::DirectedWeightedGraph<RouteWeight>& graph,
+		const Catalogue& catalogue,
+		const RoutingSettings& settings,
+		const std::vector<size_t>& vertex_stop_ids)
+	{
+		switch (settings.router_type) {
+		case (RouterType::DIJKSTRA):
+			return Engine{ std::in_place_type<graph::DijkstraRouter<RouteWeight>>, graph };
+
+		case (RouterType::A_STAR):
+			return Engine{ std::in_place_type<graph::DijkstraRouter<RouteWeight>>, graph, BuildGeoHeuristic(graph, catalogue, vertex_stop_ids) };
+
+		case (RouterType::CONTRACTION_HIERARCHIES):
+			return Engine{ std::in_place_type<graph::ContractionHierarchy<RouteWeight>>, graph };
+
+		case (RouterType::HUB_LABELS):
+			return Engine{ std::in_place_type<graph::HubLabels<RouteWeight>>, graph };
+
+		case (RouterType::BLOCKED_FLOYD_WARSHALL):
+			return Engine{ std::in_place_type<graph::Router<RouteWeight>>, graph,
+				settings.thread_count > 0 ? settings.thread_count : std::max(std::thread::hardware_concurrency(), 1u) };
+
+		case (RouterType::FLOYD_WARSHALL):
+		default:
+			return Engine{ std::in_place_type<graph::Router<RouteWeight>>, graph };
+		}
+	}
+
+	bool TransportRouter::CanRepairEngine(const Engine& engine, const RoutingSettings& settings) {
+		return std::holds_alternative<graph::Router<RouteWeight>>(engine) && settings.graph_model == GraphModel::DENSE;
+	}
+
+	TransportRouter::Engine TransportRouter::RepairEngine(
+		const graph::DirectedWeightedGraph<RouteWeight>& graph,
+		Engine&& previous_engine,
+		const std::vector<EdgeKey>& previous_edge_keys) const
+	{
+		auto* previous_router = std::get_if<graph::Router<RouteWeight>>(&previous_engine);
+		if (!CanRepairEngine(previous_engine, settings_)) {
+			// * ride vertices of the linear model are numbered by buses, the search engines are cheap to build
+			return BuildEngine(graph, catalogue_, settings_, vertex_stop_ids_);
+		}
+
+		using Router = graph::Router<RouteWeight>;
+
+		// * equal keys (a ring route may repeat a ride) are matched in any order, they are the same edge for the routes
+		std::map<EdgeKey, std::vector<graph::EdgeId>> edge_ids;
+		std::vector<EdgeKey> edge_keys = GetEdgeKeys();
+		for (graph::EdgeId edge_id = 0; edge_id < edge_keys.size(); ++edge_id) {
+			edge_ids[std::move(edge_keys[edge_id])].push_back(edge_id);
+		}
+
+		std::vector<uint32_t> new_edge_ids(previous_edge_keys.size(), Router::NO_EDGE);
+		for (graph::EdgeId edge_id = 0; edge_id < previous_edge_keys.size(); ++edge_id) {
+			auto it = edge_ids.find(previous_edge_keys[edge_id]);
+			if (it != edge_ids.end() && !it->second.empty()) {
+				new_edge_ids[edge_id] = static_cast<uint32_t>(it->second.back());
+				it->second.pop_back();
+			}
+		}
+
+		return Engine{ std::in_place_type<Router>, graph, std::move(*previous_router), new_edge_ids };
+	}
 
 	json::Node TransportRouter::BuildRoute(const json::Dict& query) const {
-		return BuildRoute(query.at("from").AsString(), query.at("to").AsString());
+		using namespace std::literals;
+
+		if (!query.count("from_point"s) && !query.count("to_point"s)) {
+			return BuildRoute(query.at("from"s).AsString(), query.at("to"s).AsString());
+		}
+
+		return BuildRoute(MakeRouteEnd(query, "from"s, "from_point"s), MakeRouteEnd(query, "to"s, "to_point"s));
 	}
 
 	json::Node TransportRouter::BuildRoute(std::string_view stop_name_from, std::string_view stop_name_to) const {
+		const graph::VertexId from = GetStopVertex(stop_name_from);
+		const graph::VertexId to = GetStopVertex(stop_name_to);
+
+		if (!route_cache_) {
+			return BuildRoute(from, to);
+		}
+
+		const RouteCache::Key key{ from / 2, to / 2 };
+		if (std::optional<json::Node> response = route_cache_->Find(key)) {
+			return *std::move(response);
+		}
+
+		json::Node response = BuildRoute(from, to);
+		route_cache_->Put(key, response);
+
+		return response;
+	}
+
+	json::Node TransportRouter::BuildRoute(graph::VertexId from, graph::VertexId to) const {
+		using namespace std::literals;
+
+		json::Dict result{};
+
+		std::unique_lock lock(*search_mutex_);
+		std::optional<graph::Router<RouteWeight>::RouteInfo> route = std::visit(
+			[from, to](const auto& router) { return router.BuildRoute(from, to); },
+			router_);
+		lock.unlock();
+
+		if (!route) {
+			result["error_message"s] = "not found"s;
+			return json::Node{ result };
+		}
+
+		result["total_time"s] = route->weight;
+		result["items"s] = BuildRouteItems(route->edges);
+
+		return json::Node{ std::move(result) };
+	}
+
+	json::Node TransportRouter::BuildRoute(const RouteEnd& from, const RouteEnd& to) const {
 		using namespace std::literals;
 
+		// * the walk between the ends themselves competes with every ride
+		std::optional<double> walk_distance;
+		if (from.is_point || to.is_point) {
+			walk_distance = geo::ComputeDistance(from.coordinates, to.coordinates);
+		}
+
+		std::unique_lock lock(*search_mutex_);
+		const std::optional<graph::DijkstraRouter<RouteWeight>::MultiRouteInfo> route =
+			GetTreeRouter().BuildRoute(from.vertices, to.vertices);
+		lock.unlock();
+
 		json::Dict result{};
 
-		std::optional<graph::Router<RouteWeight>::RouteInfo> route
-			= router_.BuildRoute(
-				stop_name_to_id_.at(stop_name_from) * 2
-				, stop_name_to_id_.at(stop_name_to) * 2);
+		if (walk_distance && (!route || GetWalkTime(*walk_distance) <= route->route.weight)) {
+			const Minutes time = GetWalkTime(*walk_distance);
+			result["total_time"s] = time;
+			result["items"s] = json::Array{ BuildWalkItem(*walk_distance, time, nullptr) };
+			return json::Node{ std::move(result) };
+		}
 
 		if (!route) {
 			result["error_message"s] = "not found"s;
 			return json::Node{ result };
 		}
 
-		result["total_time"s] = route->weight.weight;
+		json::Array items{};
+		if (from.is_point) {
+			const auto& [stop, distance] = from.walk_stops[route->source_index];
+			items.push_back(BuildWalkItem(distance, from.vertices[route->source_index].second, stop));
+		}
+		for (json::Node& item : BuildRouteItems(route->route.edges)) {
+			items.push_back(std::move(item));
+		}
+		if (to.is_point) {
+			const auto& [stop, distance] = to.walk_stops[route->target_index];
+			items.push_back(BuildWalkItem(distance, to.vertices[route->target_index].second, stop));
+		}
+
+		result["total_time"s] = route->route.weight;
+		result["items"s] = std::move(items);
+
+		return json::Node{ std::move(result) };
+	}
+
+	TransportRouter::RouteEnd TransportRouter::MakeRouteEnd(const json::Dict& query, const std::string& stop_key, const std::string& point_key) const {
+		using namespace std::literals;
+
+		RouteEnd result;
+
+		if (!query.count(point_key)) {
+			const graph::VertexId vertex = GetStopVertex(query.at(stop_key).AsString());
+			result.coordinates = GetStopById(vertex / 2).coordinates;
+			result.vertices.emplace_back(vertex, 0.);
+			return result;
+		}
+
+		const json::Dict& point = query.at(point_key).AsDict();
+		result.coordinates = { point.at("latitude"s).AsDouble(), point.at("longitude"s).AsDouble() };
+		result.is_point = true;
+
+		// * the walk goes to the entry vertex: boarding there still takes the wait
+		result.walk_stops = catalogue_.FindNearestStops(result.coordinates, settings_.walking_stop_count, std::nullopt);
+		for (const auto& [stop, distance] : result.walk_stops) {
+			result.vertices.emplace_back(stop->id * 2, GetWalkTime(distance));
+		}
+
+		return result;
+	}
+
+	Minutes TransportRouter::GetWalkTime(double distance) const {
+		// * km/h to metres per minute
+		return distance / (settings_.walking_velocity * 1000. / 60.);
+	}
+
+	json::Dict TransportRouter::BuildWalkItem(double distance, double time, const Stop* stop) {
+		using namespace std::literals;
+
+		json::Dict item{
+			{"time"s, time},
+			{"type"s, "Walk"s},
+			{"distance"s, distance} };
+		if (stop) {
+			item["stop_name"s] = std::string(stop->name);
+		}
+
+		return item;
+	}
+
+	json::Node TransportRouter::BuildRouteMatrix(const json::Dict& query) const {
+		using namespace std::literals;
+
+		std::vector<graph::VertexId> sources;
+		for (const json::Node& stop_name : query.at("from"s).AsArray()) {
+			sources.push_back(GetStopVertex(stop_name.AsString()));
+		}
+
+		std::vector<graph::VertexId> targets;
+		for (const json::Node& stop_name : query.at("to"s).AsArray()) {
+			targets.push_back(GetStopVertex(stop_name.AsString()));
+		}
+
+		const bool with_items = query.count("with_items"s) && query.at("with_items"s).AsBool();
 
+		json::Array total_times{};
 		json::Array items{};
 
+		for (const auto& routes_row : BuildRoutes(sources, targets, with_items)) {
+			json::Array total_times_row{};
+			json::Array items_row{};
+
+			for (const auto& route : routes_row) {
+				if (!route) {
+					total_times_row.push_back(nullptr);
+					items_row.push_back(nullptr);
+					continue;
+				}
+
+				total_times_row.push_back(route->weight);
+				if (with_items) {
+					items_row.push_back(BuildRouteItems(route->edges));
+				}
+			}
 
-		for (graph::EdgeId edge_id : route->edges) {
-			const graph::Edge<RouteWeight>& edge = graph_->GetEdge(edge_id);
-			json::Dict item{ {"time"s, edge.weight.weight} };
+			total_times.push_back(std::move(total_times_row));
+			items.push_back(std::move(items_row));
+		}
+
+		json::Dict result{ {"total_time"s, std::move(total_times)} };
+		if (with_items) {
+			result["items"s] = std::move(items);
+		}
+
+		return json::Node{ std::move(result) };
+	}
 
 
-			switch (edge.weight.type) {
+
+	std::vector<std::vector<std::optional<graph::Router<TransportRouter::RouteWeight>::RouteInfo>>> TransportRouter::BuildRoutes(
+		const std::vector<graph::VertexId>& sources,
+		const std::vector<graph::VertexId>& targets,
+		bool with_edges) const
+	{
+		using RouteInfo = graph::Router<RouteWeight>::RouteInfo;
+
+		std::vector<std::vector<std::optional<RouteInfo>>> result;
+		result.reserve(sources.size());
+
+		std::lock_guard lock(*search_mutex_);
+
+		if (const auto* labels = std::get_if<graph::HubLabels<RouteWeight>>(&router_)) {
+			for (graph::VertexId from : sources) {
+				std::vector<std::optional<RouteInfo>>& row = result.emplace_back();
+				row.reserve(targets.size());
+				for (graph::VertexId to : targets) {
+					if (with_edges) {
+						row.push_back(labels->BuildRoute(from, to));
+					}
+					else if (const std::optional<RouteWeight> weight = labels->GetDistance(from, to)) {
+						row.push_back(RouteInfo{ *weight, {} });
+					}
+					else {
+						row.push_back(std::nullopt);
+					}
+				}
+			}
+			return result;
+		}
+
+		if (const auto* router = std::get_if<graph::Router<RouteWeight>>(&router_)) {
+			for (graph::VertexId from : sources) {
+				std::vector<std::optional<RouteInfo>>& row = result.emplace_back();
+				row.reserve(targets.size());
+				for (graph::VertexId to : targets) {
+					row.push_back(router->BuildRoute(from, to));
+				}
+			}
+			return result;
+		}
+
+		// * a hierarchy answers single pairs, a plain search tree is cheaper for a whole row
+		const graph::DijkstraRouter<RouteWeight>& router = GetTreeRouter();
+
+		for (graph::VertexId from : sources) {
+			result.push_back(router.BuildRoutes(from, targets));
+		}
+
+		return result;
+	}
+
+
+
+	std::vector<std::pair<std::string_view, double>> TransportRouter::FindReachableStops(std::string_view stop_name, double minutes) const {
+		std::vector<std::pair<std::string_view, double>> result;
+
+		std::lock_guard lock(*search_mutex_);
+		const graph::DijkstraRouter<RouteWeight>& router = GetTreeRouter();
+
+		// * entry vertices 2 * i are the arrivals at the stop i, the search settles them in the order of time
+		const graph::VertexId stop_vertices_end = catalogue_.GetStopsCount() * 2;
+		router.VisitReachable(
+			GetStopVertex(stop_name),
+			minutes,
+			[this, &result, stop_vertices_end](graph::VertexId vertex, RouteWeight weight) {
+				if (vertex < stop_vertices_end && vertex % 2 == 0) {
+					result.emplace_back(GetStopById(vertex / 2).name, weight);
+				}
+			});
+
+		return result;
+	}
+
+
+
+	const graph::DijkstraRouter<TransportRouter::RouteWeight>& TransportRouter::GetTreeRouter() const {
+		if (const auto* router = std::get_if<graph::DijkstraRouter<RouteWeight>>(&router_)) {
+			return *router;
+		}
+		if (!tree_router_) {
+			tree_router_ = std::make_unique<graph::DijkstraRouter<RouteWeight>>(*graph_);
+		}
+		return *tree_router_;
+	}
+
+
+
+	json::Array TransportRouter::BuildRouteItems(const std::vector<graph::EdgeId>& edges) const {
+		using namespace std::literals;
+
+		json::Array items{};
+
+		// * consecutive BUS edges of one bus are a single ride (boarding, stretches and alighting of the linear model)
+		std::optional<EdgeInfo> bus_ride;
+		double bus_ride_time = 0.;
+
+		for (graph::EdgeId edge_id : edges) {
+			const RouteWeight time = graph_->GetEdge(edge_id).weight;
+			const EdgeInfo& info = edge_infos_[edge_id];
+
+			if (info.type == PassengerActivityType::BUS && bus_ride && bus_ride->id == info.id) {
+				bus_ride_time += time;
+				bus_ride->span_count += info.span_count;
+				continue;
+			}
+
+			if (bus_ride) {
+				items.push_back(BuildBusItem(*bus_ride, bus_ride_time));
+				bus_ride.reset();
+			}
+
+			switch (info.type) {
 			case (PassengerActivityType::WAIT):
-				item["type"s] = "Wait"s;
-				item["stop_name"s] = std::string(edge.weight.name);
+				items.push_back(json::Dict{
+					{"time"s, time},
+					{"type"s, "Wait"s},
+					{"stop_name"s, std::string(GetStopById(info.id).name)} });
 
 				break;
 
 			case (PassengerActivityType::BUS):
-				item["type"s] = "Bus"s;
-				item["bus"s] = std::string(edge.weight.name);
-				item["span_count"s] = static_cast<int>(edge.weight.span_count);
+				bus_ride = info;
+				bus_ride_time = time;
 
 				break;
-			case (PassengerActivityType::MIXED):
-				throw(std::invalid_argument("..."s));
-				break;
-			}
 
+			case (PassengerActivityType::WALK): {
+				const Stop& stop = GetStopById(info.id);
+				const double distance = geo::ComputeDistance(GetStopById(vertex_stop_ids_[graph_->GetEdge(edge_id).from]).coordinates, stop.coordinates);
+				items.push_back(BuildWalkItem(distance, time, &stop));
 
-			items.push_back(std::move(item));
+				break;
+			}
+			}
 		}
 
-		result["items"s] = std::move(items);
+		if (bus_ride) {
+			items.push_back(BuildBusItem(*bus_ride, bus_ride_time));
+		}
 
-		return json::Node{ std::move(result) };
+		return items;
 	}
 
 
 
-	const std::unordered_map<std::string_view, size_t>& TransportRouter::GetStopNamesToIds() const {
-		return stop_name_to_id_;
-	}
 	const graph::DirectedWeightedGraph<transport_catalogue::TransportRouter::RouteWeight>& TransportRouter::GetGraph() const {
 		return *graph_;
 	}
-	const graph::Router<transport_catalogue::TransportRouter::RouteWeight>& TransportRouter::GetRouter() const {
+	const TransportRouter::Engine& TransportRouter::GetRouter() const {
 		return router_;
 	}
+	const RoutingSettings& TransportRouter::GetRoutingSettings() const {
+		return settings_;
+	}
+	const std::vector<size_t>& TransportRouter::GetVertexStopIds() const {
+		return vertex_stop_ids_;
+	}
+	const std::vector<TransportRouter::EdgeInfo>& TransportRouter::GetEdgeInfos() const {
+		return edge_infos_;
+	}
+	bool TransportRouter::IsEngineRepaired() const {
+		return is_engine_repaired_;
+	}
+
+	size_t TransportRouter::GetWalkEdgeCount() const {
+		return std::count_if(edge_infos_.begin(), edge_infos_.end(), [](const EdgeInfo& info) {
+			return info.type == PassengerActivityType::WALK;
+		});
+	}
+	std::optional<RouteCache::Stats> TransportRouter::GetRouteCacheStats() const {
+		if (!route_cache_) {
+			return std::nullopt;
+		}
+		return route_cache_->GetStats();
+	}
+	std::vector<TransportRouter::EdgeKey> TransportRouter::GetEdgeKeys() const {
+		std::vector<EdgeKey> result;
+		result.reserve(edge_infos_.size());
+
+		for (graph::EdgeId edge_id = 0; edge_id < edge_infos_.size(); ++edge_id) {
+			const graph::Edge<RouteWeight>& edge = graph_->GetEdge(edge_id);
+			const EdgeInfo& info = edge_infos_[edge_id];
+
+			result.push_back({
+				edge.from,
+				edge.to,
+				edge.weight,
+				info.type,
+				std::string(info.type == PassengerActivityType::BUS ? catalogue_.GetBuses()[info.id].name : GetStopById(info.id).name),
+				info.span_count });
+		}
+
+		return result;
+	}
+
+
+
+	bool TransportRouter::EdgeKey::operator<(const EdgeKey& other) const {
+		return std::tie(from, to, weight, type, name, span_count)
+			< std::tie(other.from, other.to, other.weight, other.type, other.name, other.span_count);
+	}
+
+
+
+	json::Dict TransportRouter::BuildBusItem(const EdgeInfo& bus_ride, double time) const {
+		using namespace std::literals;
+
+		return json::Dict{
+			{"time"s, time},
+			{"type"s, "Bus"s},
+			{"bus"s, std::string(catalogue_.GetBuses()[bus_ride.id].name)},
+			{"span_count"s, static_cast<int>(bus_ride.span_count)} };
+	}
 
 
 
@@ -91,26 +531,173 @@ namespace transport_catalogue {
 		return catalogue_.GetStops()[id];
 	}
 
+	graph::VertexId TransportRouter::GetStopVertex(std::string_view stop_name) const {
+		const Stop* stop = catalogue_.FindStop(stop_name);
+		if (stop == nullptr) {
+			throw std::out_of_range("Unknown stop");
+		}
+		return stop->id * 2;
+	}
+
+	std::unique_ptr<RouteCache> TransportRouter::MakeRouteCache(const RoutingSettings& settings) {
+		if (settings.route_cache_capacity == 0) {
+			return nullptr;
+		}
+		return std::make_unique<RouteCache>(settings.route_cache_capacity);
+	}
+
+
+	graph::DijkstraRouter<TransportRouter::RouteWeight>::Heuristic TransportRouter::BuildGeoHeuristic(
+		const graph::DirectedWeightedGraph<RouteWeight>& graph,
+		const Catalogue& catalogue,
+		const std::vector<size_t>& vertex_stop_ids)
+	{
+		std::vector<geo::PreparedCoordinates> coordinates;
+		coordinates.reserve(vertex_stop_ids.size());
+		for (size_t stop_id : vertex_stop_ids) {
+			coordinates.push_back(geo::PrepareCoordinates(catalogue.GetStops()[stop_id].coordinates));
+		}
+
+		double max_speed = 0.;
+		for (const graph::Edge<RouteWeight>& edge : graph.GetEdges()) {
+			const double distance = geo::ComputeDistance(coordinates[edge.from], coordinates[edge.to]);
+			if (distance == 0.) {
+				continue;
+			}
+			if (edge.weight <= 0.) {
+				return {};
+			}
+			max_speed = std::max(max_speed, distance / edge.weight);
+		}
+
+		if (max_speed == 0.) {
+			return {};
+		}
+
+		// * a little margin keeps the bound admissible after rounding
+		const double minutes_per_metre = 1. / (max_speed * (1. + 1e-9));
+
+		return [coordinates = std::move(coordinates), minutes_per_metre](graph::VertexId vertex, graph::VertexId target) {
+			return geo::ComputeDistance(coordinates[vertex], coordinates[target]) * minutes_per_metre;
+		};
+	}
+
+
+	void TransportRouter::BuildRoadsFromStopOnGraph(
+		size_t begin,
+		size_t end,
+		const std::vector<size_t>& stop_ids,
+		const std::vector<double>& forward_times,
+		const std::vector<double>& backward_times,
+		graph::DirectedWeightedGraph<RouteWeight>& graph,
+		size_t bus_id)
+	{
+		const bool is_ring_route = catalogue_.GetBuses()[bus_id].is_ring_route;
+		const size_t last = stop_ids.size() - 1;
+		const size_t curent_stop_id = stop_ids[begin];
+
+		for (size_t destination = begin + 1; destination < end; ++destination) {
+			const size_t span_count = destination - begin;
+			const size_t destination_stop_id = stop_ids[destination];
+
+			AddEdge(graph
+				, { curent_stop_id * 2 + 1, destination_stop_id * 2, forward_times[destination] - forward_times[begin] }
+				, { PassengerActivityType::BUS, bus_id, span_count });
+
+			if (!is_ring_route) {
+				AddEdge(graph
+					, { destination_stop_id * 2 + 1, curent_stop_id * 2, backward_times[last - begin] - backward_times[last - destination] }
+					, { PassengerActivityType::BUS, bus_id, span_count });
+			}
+		}
+	}
+
+
+
+	void TransportRouter::AddEdge(graph::DirectedWeightedGraph<RouteWeight>& graph, const graph::Edge<RouteWeight>& edge, const EdgeInfo& info) {
+		graph.AddEdge(edge);
+		edge_infos_.push_back(info);
+	}
+
+
+
+	void TransportRouter::BuildWalkTransfersOnGraph(graph::DirectedWeightedGraph<RouteWeight>& graph) {
+		for (const Stop& stop : catalogue_.GetStops()) {
+			for (const auto& [nearby_stop, distance] : catalogue_.FindNearestStops(stop.coordinates, std::nullopt, settings_.walking_transfer_radius)) {
+				if (nearby_stop == &stop) {
+					continue;
+				}
+				// * from arrival to arrival: the walk comes after the ride, boarding at the other stop takes its wait
+				AddEdge(graph
+					, { stop.id * 2, nearby_stop->id * 2, GetWalkTime(distance) }
+					, { PassengerActivityType::WALK, nearby_stop->id, 0 });
+			}
+		}
+	}
 
 	graph::DirectedWeightedGraph<TransportRouter::RouteWeight>& TransportRouter::InitGraph() {
-		graph::DirectedWeightedGraph<RouteWeight> graph(catalogue_.GetStopsCount() * 2);
+		size_t vertex_count = catalogue_.GetStopsCount() * 2;
+		if (settings_.graph_model == GraphModel::LINEAR) {
+			// * a ride vertex per stop of every direction of a bus
+			for (const Bus& bus : catalogue_.GetBuses()) {
+				vertex_count += (bus.keys_for_distance.size() + 1) * (bus.is_ring_route ? 1 : 2);
+			}
+		}
+		graph::DirectedWeightedGraph<RouteWeight> graph(vertex_count);
+		vertex_stop_ids_.clear();
+		vertex_stop_ids_.reserve(vertex_count);
+		edge_infos_.clear();
 
 		//enter to exit edges 
 		for (size_t i = 0; i < catalogue_.GetStopsCount(); ++i) {
-			std::string_view stop_name = GetStopById(i).name;
-			graph.AddEdge({ i * 2, i * 2 + 1, { PassengerActivityType::WAIT, catalogue_.GetWaitTime(), stop_name, 0} });
-			stop_name_to_id_[stop_name] = i;
+			AddEdge(graph, { i * 2, i * 2 + 1, catalogue_.GetWaitTime() }, { PassengerActivityType::WAIT, i, 0 });
+			vertex_stop_ids_.push_back(i);
+			vertex_stop_ids_.push_back(i);
+		}
+
+		if (settings_.walking_transfer_radius > 0.) {
+			BuildWalkTransfersOnGraph(graph);
 		}
 
 
-		for (const Bus& bus : catalogue_.GetBuses()) {
+		for (size_t bus_id = 0; bus_id < catalogue_.GetBusesCount(); ++bus_id) {
+			const Bus& bus = catalogue_.GetBuses()[bus_id];
 			auto stops = bus.GetStops();
-			BuildRoadsFromStopOnGraph(stops.begin(), (bus.is_ring_route ? std::prev(stops.end()) : stops.end()), graph, bus);
 
-			for (auto stop_it = std::next(stops.begin()); stop_it != stops.end(); ++stop_it) {
-				BuildRoadsFromStopOnGraph(stop_it, stops.end(), graph, bus);
+			if (settings_.graph_model == GraphModel::LINEAR) {
+				BuildBusLineOnGraph(stops.begin(), stops.end(), graph, bus_id);
+				if (!bus.is_ring_route) {
+					BuildBusLineOnGraph(stops.rbegin(), stops.rend(), graph, bus_id);
+				}
+				continue;
+			}
+
+			std::vector<size_t> stop_ids;
+			stop_ids.reserve(stops.size());
+			for (const Stop* stop : stops) {
+				stop_ids.push_back(stop->id);
 			}
+
+			// * the backward sums run from the last stop, so the ride from j back to i is backward[k - 1 - i] - backward[k - 1 - j]
+			const std::vector<double> forward_times = CalculateRideTimePrefixSums(stops.begin(), stops.end());
+			const std::vector<double> backward_times = bus.is_ring_route
+				? std::vector<double>{}
+				: CalculateRideTimePrefixSums(stops.rbegin(), stops.rend());
+
+			BuildRoadsFromStopOnGraph(0, (bus.is_ring_route ? stops.size() - 1 : stops.size()), stop_ids, forward_times, backward_times, graph, bus_id);
+
+			for (size_t i = 1; i < stops.size(); ++i) {
+				BuildRoadsFromStopOnGraph(i, stops.size(), stop_ids, forward_times, backward_times, graph, bus_id);
+			}
+		}
+
+		// * the frozen graph renumbers the edges, their metadata follows
+		const std::vector<graph::EdgeId> new_edge_ids = graph.Finalize();
+		std::vector<EdgeInfo> edge_infos(edge_infos_.size());
+		for (graph::EdgeId edge_id = 0; edge_id < edge_infos_.size(); ++edge_id) {
+			edge_infos[new_edge_ids[edge_id]] = edge_infos_[edge_id];
 		}
+		edge_infos_ = std::move(edge_infos);
 
 		graph_ = new graph::DirectedWeightedGraph<TransportRouter::RouteWeight>(std::move(graph));
 
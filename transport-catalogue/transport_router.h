@@ -2,78 +2,232 @@
 
 #include "graph.h"
 #include "router.h"
+#include "dijkstra_router.h"
+#include "contraction_hierarchy.h"
+#include "hub_labels.h"
+#include "route_cache.h"
 #include "transport_catalogue.h"
 #include "json.h"
 
+#include <memory>
+#include <mutex>
+#include <string>
 #include <string_view>
 #include <unordered_map>
+#include <variant>
 #include <vector>
 
 #include <utility>
 
 namespace transport_catalogue {
 
+	enum class RouterType {
+		FLOYD_WARSHALL,
+		DIJKSTRA,
+		CONTRACTION_HIERARCHIES,
+		BLOCKED_FLOYD_WARSHALL,
+		A_STAR,
+		HUB_LABELS
+	};
+
+	enum class GraphModel {
+		// an edge from every stop of a bus to every later stop of it
+		DENSE,
+		// a chain of ride vertices per bus with boarding and alighting edges
+		LINEAR
+	};
+
+	struct RoutingSettings {
+		RouterType router_type = RouterType::FLOYD_WARSHALL;
+		GraphModel graph_model = GraphModel::DENSE;
+		// 0 means one thread per hardware core
+		size_t thread_count = 0;
+		// Route responses kept for repeated requests, 0 turns the cache off
+		size_t route_cache_capacity = 0;
+		// walking speed of the legs between a point of a Route request and a stop, in km/h
+		double walking_velocity = 4.;
+		// nearest stops a point of a Route request is joined to
+		size_t walking_stop_count = 3;
+		// stops closer than this many metres are joined by walking transfers, 0 turns them off
+		double walking_transfer_radius = 0.;
+	};
+
 
 	class TransportRouter {
 	public:
 		enum class PassengerActivityType {
 			WAIT,
 			BUS,
-			MIXED
+			WALK
 		};
 
-		struct RouteWeight {
-			PassengerActivityType type;
-			double weight = 0;
-			std::string_view name;
+		// * the graph keeps only the time in minutes, everything an itinerary needs is in EdgeInfo
+		using RouteWeight = double;
+
+		// metadata of the edge with the same id, read only to build itineraries
+		struct EdgeInfo {
+			PassengerActivityType type = PassengerActivityType::WAIT;
+			// the stop id of a WAIT edge, the bus id of a BUS edge, the stop walked to of a WALK edge
+			size_t id = 0;
 			size_t span_count = 0;
+		};
 
-			inline bool operator>(const RouteWeight& other) const;
-			inline bool operator<(const RouteWeight& other) const;
-			inline bool operator==(const RouteWeight& other) const;
-			inline bool operator>=(const RouteWeight& other) const;
-			inline bool operator<=(const RouteWeight& other) const;
-			inline RouteWeight operator+(const RouteWeight& other) const;
+		// an edge described without ids, so that it can be found again in a graph built after the catalogue changed
+		struct EdgeKey {
+			graph::VertexId from = 0;
+			graph::VertexId to = 0;
+			RouteWeight weight = 0.;
+			PassengerActivityType type = PassengerActivityType::WAIT;
+			// the stop of a WAIT edge, the bus of a BUS edge, the stop walked to of a WALK edge
+			std::string name;
+			size_t span_count = 0;
+
+			bool operator<(const EdgeKey& other) const;
 		};
 
 
-		TransportRouter(const Catalogue& catalogue);
+		using Engine = std::variant<
+			graph::Router<RouteWeight>,
+			graph::DijkstraRouter<RouteWeight>,
+			graph::ContractionHierarchy<RouteWeight>,
+			graph::HubLabels<RouteWeight>>;
+
+
+		TransportRouter(const Catalogue& catalogue, const RoutingSettings& settings = {});
 		TransportRouter(
 			const Catalogue& catalogue, 
 			graph::DirectedWeightedGraph<RouteWeight>& graph, 
-			graph::Router<RouteWeight>::RoutesInternalData&& routes_internal_data, 
-			std::unordered_map<std::string_view, size_t>&& stop_name_to_id);
+			const RoutingSettings& settings,
+			Engine&& engine,
+			std::vector<size_t>&& vertex_stop_ids,
+			std::vector<EdgeInfo>&& edge_infos);
+		// the router of the changed catalogue, previous_edge_keys are the keys of the previous router taken before the change;
+		// the Floyd-Warshall matrix of the dense model is repaired, the other engines are built anew
+		TransportRouter(
+			const Catalogue& catalogue,
+			TransportRouter&& previous,
+			const std::vector<EdgeKey>& previous_edge_keys);
+
+		static Engine BuildEngine(
+			const graph::DirectedWeightedGraph<RouteWeight>& graph,
+			const Catalogue& catalogue,
+			const RoutingSettings& settings,
+			const std::vector<size_t>& vertex_stop_ids);
 
+		// the ends are stops (from, to) or points (from_point, to_point) joined by walks to their nearest stops
 		json::Node BuildRoute(const json::Dict& query) const;
 		json::Node BuildRoute(std::string_view stop_name_from, std::string_view stop_name_to) const;
+		// total_time of every from x to pair (null if there is no route) and, with with_items, the items as well
+		json::Node BuildRouteMatrix(const json::Dict& query) const;
+		// stops reachable from the stop within the minutes, sorted by the travel time
+		std::vector<std::pair<std::string_view, double>> FindReachableStops(std::string_view stop_name, double minutes) const;
 
 
-		const std::unordered_map<std::string_view, size_t>& GetStopNamesToIds() const;
 		const graph::DirectedWeightedGraph<RouteWeight>& GetGraph() const;
-		const graph::Router<RouteWeight>& GetRouter() const;
+		const Engine& GetRouter() const;
+		const RoutingSettings& GetRoutingSettings() const;
+		const std::vector<size_t>& GetVertexStopIds() const;
+		const std::vector<EdgeInfo>& GetEdgeInfos() const;
+		size_t GetWalkEdgeCount() const;
+		std::vector<EdgeKey> GetEdgeKeys() const;
+		// true when the updating constructor repaired the previous engine instead of building it anew
+		bool IsEngineRepaired() const;
+		// nullopt when the cache is off
+		std::optional<RouteCache::Stats> GetRouteCacheStats() const;
 
 
 	private:
 		const Catalogue& catalogue_;
-		std::unordered_map<std::string_view, size_t> stop_name_to_id_;
 
 		graph::DirectedWeightedGraph<RouteWeight>* graph_;
-		graph::Router<RouteWeight> router_;
-
-		static constexpr RouteWeight ZERO_WEIGHT{ PassengerActivityType::WAIT, 0, "", 0};
+		RoutingSettings settings_;
+		// stop of every graph vertex: 2 * i and 2 * i + 1 for the stop with id i, then the ride vertices of the linear model
+		std::vector<size_t> vertex_stop_ids_;
+		std::vector<EdgeInfo> edge_infos_;
+		Engine router_;
+		// * behind a pointer: the mutex of the cache would make the router immovable
+		std::unique_ptr<RouteCache> route_cache_;
+		// * the engines keep their search buffers in mutable members, so the searches of one router go one at a time;
+		// the cached responses are read without it
+		std::unique_ptr<std::mutex> search_mutex_;
+		// search router for point routes, matrices and reachable stops when the engine is not a Dijkstra router
+		mutable std::unique_ptr<graph::DijkstraRouter<RouteWeight>> tree_router_;
+		bool is_engine_repaired_ = false;
 
 
 		const Stop& GetStopById(size_t id) const;
+		// entry vertex of the stop, the name is looked up only here
+		graph::VertexId GetStopVertex(std::string_view stop_name) const;
+
+		// one end of a Route request: a stop, or a point with the stops it can walk to
+		struct RouteEnd {
+			geo::Coordinates coordinates;
+			bool is_point = false;
+			// entry vertices of the stops and the walking time in minutes, parallel to walk_stops
+			std::vector<graph::DijkstraRouter<RouteWeight>::WeightedVertex> vertices;
+			std::vector<std::pair<const Stop*, double>> walk_stops;
+		};
+
+		json::Node BuildRoute(graph::VertexId from, graph::VertexId to) const;
+		json::Node BuildRoute(const RouteEnd& from, const RouteEnd& to) const;
+		RouteEnd MakeRouteEnd(const json::Dict& query, const std::string& stop_key, const std::string& point_key) const;
+		Minutes GetWalkTime(double distance) const;
+		static json::Dict BuildWalkItem(double distance, double time, const Stop* stop);
+		static std::unique_ptr<RouteCache> MakeRouteCache(const RoutingSettings& settings);
+
+		// lower bound of the ride time between stops: great-circle distance at the fastest speed met on the graph
+		static graph::DijkstraRouter<RouteWeight>::Heuristic BuildGeoHeuristic(
+			const graph::DirectedWeightedGraph<RouteWeight>& graph,
+			const Catalogue& catalogue,
+			const std::vector<size_t>& vertex_stop_ids);
+
+		json::Dict BuildBusItem(const EdgeInfo& bus_ride, double time) const;
+		json::Array BuildRouteItems(const std::vector<graph::EdgeId>& edges) const;
+
+		// the engine itself when it is a Dijkstra router, otherwise a search router over the graph built on the first call;
+		// the caller holds the search lock
+		const graph::DijkstraRouter<RouteWeight>& GetTreeRouter() const;
+
+		// routes from every source to every target: matrix lookups for Floyd-Warshall, label merges for hub labels,
+		// one search tree per source otherwise; without with_edges the routes may come without their edges
+		std::vector<std::vector<std::optional<graph::Router<RouteWeight>::RouteInfo>>> BuildRoutes(
+			const std::vector<graph::VertexId>& sources,
+			const std::vector<graph::VertexId>& targets,
+			bool with_edges) const;
 
 		
 
 
 
+		// only the all-pairs matrix over the dense graph is repaired, the other engines are built anew
+		static bool CanRepairEngine(const Engine& engine, const RoutingSettings& settings);
+		Engine RepairEngine(
+			const graph::DirectedWeightedGraph<RouteWeight>& graph,
+			Engine&& previous_engine,
+			const std::vector<EdgeKey>& previous_edge_keys) const;
+
+		void AddEdge(graph::DirectedWeightedGraph<RouteWeight>& graph, const graph::Edge<RouteWeight>& edge, const EdgeInfo& info);
+
+		// ride time from the first stop to every stop of the range, the first element is 0
 		template <typename StopsIterator>
-		double CalculateBusRideTime(StopsIterator route_begin, StopsIterator route_end) const;
+		std::vector<double> CalculateRideTimePrefixSums(StopsIterator route_begin, StopsIterator route_end) const;
+
+		// edges from the stop begin to the stops (begin, end) of the bus; ride times come from the prefix sums in O(1)
+		void BuildRoadsFromStopOnGraph(
+			size_t begin,
+			size_t end,
+			const std::vector<size_t>& stop_ids,
+			const std::vector<double>& forward_times,
+			const std::vector<double>& backward_times,
+			graph::DirectedWeightedGraph<RouteWeight>& graph,
+			size_t bus_id);
+
+		// walks from the arrival at every stop to the arrival at the stops within the walking transfer radius,
+		// the pairs come from the stops grid instead of a scan over all the pairs
+		void BuildWalkTransfersOnGraph(graph::DirectedWeightedGraph<RouteWeight>& graph);
 
 		template <typename StopsIterator>
-		void BuildRoadsFromStopOnGraph(StopsIterator begin, StopsIterator end, graph::DirectedWeightedGraph<RouteWeight>& graph, const Bus& bus) const;
+		void BuildBusLineOnGraph(StopsIterator begin, StopsIterator end, graph::DirectedWeightedGraph<RouteWeight>& graph, size_t bus_id);
 		
 
 		graph::DirectedWeightedGraph<RouteWeight>& InitGraph();
@@ -97,55 +251,16 @@ namespace transport_catalogue {
 
 
 
-	// ********* RouteWeight *********
-
-	inline bool TransportRouter::RouteWeight::operator>(const RouteWeight& other) const {
-		return weight > other.weight;
-	}
-
-	inline bool TransportRouter::RouteWeight::operator<(const RouteWeight& other) const {
-		return weight < other.weight;
-	}
-
-	inline bool TransportRouter::RouteWeight::operator==(const RouteWeight& other) const {
-		return weight == other.weight;
-	}
-
-	inline bool TransportRouter::RouteWeight::operator>=(const RouteWeight& other) const {
-		return weight >= other.weight;
-	}
-
-	inline bool TransportRouter::RouteWeight::operator<=(const RouteWeight& other) const {
-		return weight <= other.weight;
-	}
-
-	inline TransportRouter::RouteWeight TransportRouter::RouteWeight::operator+(const RouteWeight& other) const {
-		if (*this == ZERO_WEIGHT)
-			return other;
-		else if (other == ZERO_WEIGHT)
-			return *this;
-
-
-		return { PassengerActivityType::MIXED
-			, weight + other.weight
-			, std::string_view()
-			, span_count + other.span_count };
-	}
-
-
-
-
-
-
 	// ********* TransportRouter *********
 
 
 	template <typename StopsIterator>
-	double TransportRouter::CalculateBusRideTime(StopsIterator route_begin, StopsIterator route_end) const {
-		double result = 0.;
+	std::vector<double> TransportRouter::CalculateRideTimePrefixSums(StopsIterator route_begin, StopsIterator route_end) const {
+		std::vector<double> result{ 0. };
+		result.reserve(std::distance(route_begin, route_end));
 
 		for (StopsIterator it = std::next(route_begin), prev_stop = route_begin; it != route_end; ++it, ++prev_stop) {
-			result += catalogue_.GetBusRideTime(*prev_stop, *it);
+			result.push_back(result.back() + catalogue_.GetBusRideTime(*prev_stop, *it));
 		}
 
 		return result;
@@ -154,30 +269,26 @@ namespace transport_catalogue {
 
 
 	template <typename StopsIterator>
-	void TransportRouter::BuildRoadsFromStopOnGraph(StopsIterator begin, StopsIterator end, graph::DirectedWeightedGraph<RouteWeight>& graph, const Bus& bus) const {
-		StopsIterator curent_stop = begin;
-		size_t curent_stop_id = stop_name_to_id_.at((*curent_stop)->name);
-		size_t span_count = 0;
-
-		for (StopsIterator stop_it = std::next(curent_stop); stop_it != end; ++stop_it) {
-			++span_count;
-
-			Stop* destination_stop = *stop_it;
-			size_t destination_stop_id = stop_name_to_id_.at(destination_stop->name);
-
-			graph.AddEdge({ curent_stop_id * 2 + 1, destination_stop_id * 2, {
-				PassengerActivityType::BUS
-				, CalculateBusRideTime(curent_stop, std::next(stop_it))
-				, bus.name
-				, span_count } });
-
-			if (!bus.is_ring_route) {
-				graph.AddEdge({ destination_stop_id * 2 + 1, curent_stop_id * 2, {
-					PassengerActivityType::BUS
-					, CalculateBusRideTime(std::make_reverse_iterator(std::next(stop_it)), std::make_reverse_iterator(curent_stop))
-					, bus.name
-					, span_count } });
+	void TransportRouter::BuildBusLineOnGraph(StopsIterator begin, StopsIterator end, graph::DirectedWeightedGraph<RouteWeight>& graph, size_t bus_id) {
+		graph::VertexId prev_ride_vertex = 0;
+
+		for (StopsIterator stop_it = begin; stop_it != end; ++stop_it) {
+			const size_t stop_id = (*stop_it)->id;
+			const graph::VertexId ride_vertex = vertex_stop_ids_.size();
+			vertex_stop_ids_.push_back(stop_id);
+
+			// boarding and alighting cost nothing, the ride edges carry the time and one span each
+			if (stop_it != begin) {
+				AddEdge(graph
+					, { prev_ride_vertex, ride_vertex, catalogue_.GetBusRideTime(*std::prev(stop_it), *stop_it) }
+					, { PassengerActivityType::BUS, bus_id, 1 });
+				AddEdge(graph, { ride_vertex, stop_id * 2, 0. }, { PassengerActivityType::BUS, bus_id, 0 });
 			}
+			if (std::next(stop_it) != end) {
+				AddEdge(graph, { stop_id * 2 + 1, ride_vertex, 0. }, { PassengerActivityType::BUS, bus_id, 0 });
+			}
+
+			prev_ride_vertex = ride_vertex;
 		}
 	}
 